@@ -0,0 +1,229 @@
+#include "AreaMonitor.hpp"
+#include "ReplyWriter.hpp"
+#include "reactor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/eventfd.h>
+
+static constexpr int BACKLOG_RETRY_MS = 10;   // how soon a stuck push is retried
+static constexpr long MONITOR_INTERVAL_MS = 1;  // at most one evaluation per interval
+
+AreaMonitor::AreaMonitor()
+    : head_(0), latest_(0.0), skipped_(0), skippedLow_(HUGE_VAL), skippedHigh_(-HUGE_VAL), tail_(0), sleeping_(false), stop_(false), wakeFd_(-1), area_(0.0), nextId_(1) {
+    for (size_t i = 0; i < SLOTS; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+}
+
+AreaMonitor::~AreaMonitor() {
+    stop();
+}
+
+bool AreaMonitor::start(double area) {
+    area_ = area;
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd_ < 0) return false;
+    try {
+        thread_ = std::thread(&AreaMonitor::run, this);
+    } catch (...) {
+        close(wakeFd_);
+        wakeFd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+void AreaMonitor::stop() {
+    if (!thread_.joinable()) return;
+    stop_.store(true);
+    uint64_t one = 1;
+    (void)!write(wakeFd_, &one, sizeof(one));
+    thread_.join();
+    close(wakeFd_);
+    wakeFd_ = -1;
+}
+
+void AreaMonitor::publish(double area) {
+    latest_.store(area, std::memory_order_relaxed);
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Slot* s;
+    for (;;) {
+        s = &slots_[pos & (SLOTS - 1)];
+        size_t seq = s->seq.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            // full: keep the extremes, which cross every level this area could,
+            // before counting it; the monitor reads them after taking the count
+            double low = skippedLow_.load(std::memory_order_relaxed);
+            while (area < low && !skippedLow_.compare_exchange_weak(low, area)) {}
+            double high = skippedHigh_.load(std::memory_order_relaxed);
+            while (area > high && !skippedHigh_.compare_exchange_weak(high, area)) {}
+            skipped_.fetch_add(1);
+            return;
+        } else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+    s->area = area;
+    s->seq.store(pos + 1, std::memory_order_release);
+
+    // pairs with the fence in run(): either it sees this slot or we see it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) {
+        uint64_t one = 1;
+        (void)!write(wakeFd_, &one, sizeof(one));
+    }
+}
+
+int AreaMonitor::watch(ReplyBatch* sub, double level, double hysteresis, bool& above) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    int id = nextId_++;
+    Watch& w = watches_[id];
+    w.id = id;
+    w.level = level;
+    w.off = level - (hysteresis > 0 ? hysteresis : 0);
+    w.above = area_ >= level;
+    w.sub = sub;
+    w.onIt = byOn_.emplace(w.level, &w);
+    w.offIt = byOff_.emplace(w.off, &w);
+    above = w.above;
+    return id;
+}
+
+bool AreaMonitor::unwatch(ReplyBatch* sub, int id) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::map<int, Watch>::iterator it = watches_.find(id);
+    if (it == watches_.end() || it->second.sub != sub) return false;
+    removeWatch(it);
+    return true;
+}
+
+void AreaMonitor::dropSubscriber(ReplyBatch* sub) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (std::map<int, Watch>::iterator it = watches_.begin(); it != watches_.end();) {
+        if (it->second.sub == sub) removeWatch(it++);
+        else ++it;
+    }
+    backlogged_.erase(std::remove(backlogged_.begin(), backlogged_.end(), sub), backlogged_.end());
+}
+
+void AreaMonitor::removeWatch(std::map<int, Watch>::iterator it) {
+    byOn_.erase(it->second.onIt);
+    byOff_.erase(it->second.offIt);
+    watches_.erase(it);
+}
+
+void AreaMonitor::notify(Watch& w) {
+    if (!w.sub) {
+        if (w.above) logPrintf(LOG_LEVEL_INFO, "At Least %g units belongs to CH", w.level);
+        else logPrintf(LOG_LEVEL_INFO, "At Least %g units no longer belongs to CH", w.level);
+        return;
+    }
+    std::string msg;
+    ReplyWriter(msg) << "Event " << w.id << (w.above ? " above " : " below ") << w.level
+                     << ": area = " << area_ << '\n';
+    if (!w.sub->push(msg)) {
+        logPrintf(LOG_LEVEL_WARN, "Watch %d: subscriber too far behind, event dropped", w.id);
+        return;
+    }
+    if (!w.sub->drainPushed() &&
+        std::find(backlogged_.begin(), backlogged_.end(), w.sub) == backlogged_.end()) {
+        backlogged_.push_back(w.sub);
+    }
+}
+
+// Only a watch with an edge between the old and the new area can change
+// state: going up, those whose level was passed; going down, those whose
+// level - hysteresis was dropped under.
+void AreaMonitor::step(double area) {
+    double from = area_;
+    area_ = area;
+    if (area > from) {
+        EdgeIndex::iterator end = byOn_.upper_bound(area);
+        for (EdgeIndex::iterator it = byOn_.upper_bound(from); it != end; ++it) {
+            Watch& w = *it->second;
+            if (w.above) continue;
+            w.above = true;
+            notify(w);
+        }
+    } else if (area < from) {
+        EdgeIndex::iterator end = byOff_.upper_bound(from);
+        for (EdgeIndex::iterator it = byOff_.upper_bound(area); it != end; ++it) {
+            Watch& w = *it->second;
+            if (!w.above) continue;
+            w.above = false;
+            notify(w);
+        }
+    }
+}
+
+void AreaMonitor::run() {
+    std::vector<double> batch;
+    while (!stop_.load()) {
+        batch.clear();
+        for (;;) {
+            Slot& s = slots_[tail_ & (SLOTS - 1)];
+            if (s.seq.load(std::memory_order_acquire) != tail_ + 1) break;
+            double a = s.area;
+            s.seq.store(tail_ + SLOTS, std::memory_order_release);   // free for the next lap
+            ++tail_;
+            // still rising (or still falling): the middle value crosses nothing the ends don't
+            size_t n = batch.size();
+            if (n >= 2 && (batch[n - 2] < batch[n - 1]) == (batch[n - 1] < a)) batch[n - 1] = a;
+            else batch.push_back(a);
+        }
+        unsigned long skipped = skipped_.exchange(0);
+        if (skipped > 0) {
+            // the ring filled up: pass both extremes of what didn't fit, the
+            // one farther from where the area ended first, then end at latest_
+            double low = skippedLow_.exchange(HUGE_VAL);
+            double high = skippedHigh_.exchange(-HUGE_VAL);
+            double latest = latest_.load(std::memory_order_relaxed);
+            logPrintf(LOG_LEVEL_WARN, "Area monitor fell behind, %lu area changes folded", skipped);
+            if (low <= high) {
+                bool highFirst = high - latest > latest - low;
+                batch.push_back(highFirst ? high : low);
+                batch.push_back(highFirst ? low : high);
+            }
+            batch.push_back(latest);
+        }
+
+        bool backlog;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (double a : batch) step(a);
+            backlogged_.erase(std::remove_if(backlogged_.begin(), backlogged_.end(),
+                                             [](ReplyBatch* sub) { return sub->drainPushed(); }),
+                              backlogged_.end());
+            backlog = !backlogged_.empty();
+        }
+        if (!batch.empty()) {
+            // let the next changes pile up rather than wake for each of them
+            timespec nap = {0, MONITOR_INTERVAL_MS * 1000000};
+            nanosleep(&nap, nullptr);
+            continue;
+        }
+
+        // nothing left: sleep until a publish (or a stuck push is due a retry)
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (slots_[tail_ & (SLOTS - 1)].seq.load(std::memory_order_acquire) == tail_ + 1 ||
+            skipped_.load(std::memory_order_relaxed) > 0 || stop_.load()) {
+            sleeping_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        pollfd p{wakeFd_, POLLIN, 0};
+        int rc = poll(&p, 1, backlog ? BACKLOG_RETRY_MS : -1);
+        sleeping_.store(false, std::memory_order_relaxed);
+        if (rc > 0) {
+            uint64_t v;
+            (void)!read(wakeFd_, &v, sizeof(v));
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ReplyBatch.hpp"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+
+
+// Area threshold watches, evaluated on their own thread.
+//
+// Every new hull area is publish()ed into a bounded lock-free ring (one
+// CAS to claim a slot, one store to publish it) by whoever changed the
+// graph, which then goes on without waiting. The monitor thread takes what
+// has piled up at most once per MONITOR_INTERVAL_MS and walks the area
+// through it in order, so a crossing made and undone between two looks is
+// still seen; a run that only rises or only falls is walked as one step,
+// which crosses the same levels. Should the ring ever fill, publish()
+// still doesn't wait, but no crossing is lost either: the areas it
+// couldn't queue are folded into the lowest and highest of them, and the
+// monitor walks through both before going on to the latest area. Every
+// level a skipped area went past is still crossed, only perhaps not in
+// the order it happened.
+//
+// A watch is a level plus a hysteresis: it goes above once the area
+// reaches level and back below once the area drops under level -
+// hysteresis. Watches are kept sorted by both edges, so a step from a to
+// b only looks at the watches whose edge lies between a and b, however
+// many there are. Crossings go to the watch's connection as
+//
+//     Event <id> above <level>: area = <area>
+//     Event <id> below <level>: area = <area>
+//
+// pushed without blocking (see ReplyBatch::push). A watch with no
+// connection only logs.
+class AreaMonitor {
+public:
+    AreaMonitor();
+    ~AreaMonitor();
+
+    // area: where the graph is now, for watches set before the first publish
+    bool start(double area = 0.0);
+    void stop();
+
+    // any thread; never waits
+    void publish(double area);
+
+    // a new watch for sub (nullptr: log only); returns its id and whether
+    // the last published area already has it above
+    int watch(ReplyBatch* sub, double level, double hysteresis, bool& above);
+    bool unwatch(ReplyBatch* sub, int id);
+    // every watch of sub goes; no push reaches sub after this returns
+    void dropSubscriber(ReplyBatch* sub);
+
+private:
+    struct Watch;
+    typedef std::multimap<double, Watch*> EdgeIndex;
+
+    struct Watch {
+        int id;
+        double level;
+        double off;      // level - hysteresis
+        bool above;
+        ReplyBatch* sub;
+        EdgeIndex::iterator onIt, offIt;
+    };
+
+    struct Slot {
+        std::atomic<size_t> seq;   // == index: free; == index + 1: published
+        double area;
+    };
+
+    void run();
+    void step(double area);        // mtx_ held
+    void notify(Watch& w);         // mtx_ held
+    void removeWatch(std::map<int, Watch>::iterator it);   // mtx_ held
+
+    static constexpr size_t SLOTS = 4096;   // power of two
+
+    Slot slots_[SLOTS];
+    std::atomic<size_t> head_;     // next slot a producer claims
+    std::atomic<double> latest_;   // the last area published, ring or not
+    std::atomic<unsigned long> skipped_;   // published while the ring was full
+    std::atomic<double> skippedLow_;       // lowest and highest of those
+    std::atomic<double> skippedHigh_;
+    size_t tail_;                  // next slot to drain; monitor thread only
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> stop_;
+    int wakeFd_;
+    std::thread thread_;
+
+    std::mutex mtx_;               // everything below
+    double area_;                  // the last area stepped to
+    int nextId_;
+    std::map<int, Watch> watches_;
+    EdgeIndex byOn_, byOff_;
+    std::vector<ReplyBatch*> backlogged_;   // pushes still waiting for socket space
+};
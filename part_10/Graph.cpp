@@ -4,6 +4,8 @@
 
 void Graph::newGraph(const std::vector<Point>& points) {
     points_ = points;
+    setHull(points_);
+    changed();
 }
 
 bool Graph::addPoint(const Point& p) {
@@ -11,6 +13,12 @@ bool Graph::addPoint(const Point& p) {
         return false;
     }
     points_.push_back(p);
+    if (!inHull(p)) {
+        std::vector<Point> pts = hull_;
+        pts.push_back(p);
+        setHull(std::move(pts));
+    }
+    changed();
     return true;
 }
 
@@ -20,6 +28,11 @@ bool Graph::removePoint(const Point& p) {
         return false;
     }
     points_.erase(it, points_.end());
+    auto v = std::find(hull_.begin(), hull_.end(), p);
+    if (v != hull_.end()) {
+        removeHullVertex(v - hull_.begin());
+    }
+    changed();
     return true;
 }
 
@@ -34,6 +47,7 @@ bool Graph::addEdge(const Point& p1, const Point& p2) {
     if (std::find(edges_.begin(), edges_.end(), e) == edges_.end()) {
         edges_.push_back(e);
     }
+    changed();
     return true;
 }
 
@@ -46,17 +60,63 @@ bool Graph::removeEdge(const Point& p1, const Point& p2) {
     }
     auto e = std::make_pair(p1, p2);
     edges_.erase(std::remove(edges_.begin(), edges_.end(), e), edges_.end());
+    changed();
     return true;
 }
 
-std::vector<Point> Graph::convexHull() const {
-    std::vector<Point> pts = points_;
-    return ComputeConvexHull(pts);
+// on or inside the hull: the hull stays as it is (points on an edge are
+// never vertices)
+bool Graph::inHull(const Point& p) const {
+    size_t h = hull_.size();
+    if (h < 3) return false;
+    for (size_t i = 0; i < h; ++i) {
+        if (cross(hull_[i], hull_[(i + 1) % h], p) < 0) return false;
+    }
+    return true;
+}
+
+// Without vertex i the hull loses the triangle (prev, i, next); the only
+// points that can take its place are the ones in that triangle.
+void Graph::removeHullVertex(size_t i) {
+    size_t h = hull_.size();
+    if (h < 3) {
+        setHull(points_);
+        return;
+    }
+    const Point a = hull_[(i + h - 1) % h], b = hull_[i], c = hull_[(i + 1) % h];
+    std::vector<Point> pts;
+    pts.reserve(h + 8);
+    for (size_t j = 0; j < h; ++j) {
+        if (j != i) pts.push_back(hull_[j]);
+    }
+    for (const Point& q : points_) {
+        if (cross(a, b, q) >= 0 && cross(b, c, q) >= 0 && cross(c, a, q) >= 0) pts.push_back(q);
+    }
+    setHull(std::move(pts));
+}
+
+void Graph::setHull(std::vector<Point> pts) {
+    std::vector<Point> hull = ComputeConvexHull(pts);
+    if (hull == hull_) return;
+    hull_.swap(hull);
+    area_ = ComputeArea(hull_);
+    hullMoved_ = true;
 }
 
-double Graph::area() const {
-    auto hull = convexHull();
-    return ComputeArea(hull);
+void Graph::endBatch() {
+    if (--batchDepth_ > 0 || !batchChanged_) return;
+    batchChanged_ = false;
+    changed();
+}
+
+void Graph::changed() {
+    if (batchDepth_ > 0) {
+        batchChanged_ = true;
+        return;
+    }
+    published_.store(++version_, area_);
+    if (hullMoved_ && listener_) listener_(*this, listenerArg_);
+    hullMoved_ = false;
 }
 std::vector<Point> Graph::ComputeConvexHull(std::vector<Point>& pts) const {
     sort(pts.begin(), pts.end());           // uses Point::operator<
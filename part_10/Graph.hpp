@@ -1,9 +1,21 @@
 #pragma once
 
 #include "Point.hpp"
+#include "PublishedArea.hpp"
 #include <vector>
+#include <stddef.h>
 
 
+// The hull and its area are kept up to date as the graph changes instead of
+// being recomputed per CH: a point inside the hull changes nothing, a point
+// outside only needs the hull of the old hull plus itself, and removing a
+// hull vertex only looks again at the points it was covering. Every change bumps the version
+// and republishes (version, area), which readers may load without the lock
+// the mutations are made under.
+//
+// Mutations made between beginBatch() and endBatch() are published, and
+// reported to the listener, once at endBatch(), so nobody sees a half-applied
+// group of them.
 class Graph {
 public:
 
@@ -15,17 +27,45 @@ public:
     bool addEdge(const Point& p1, const Point& p2);
     bool removeEdge(const Point& p1, const Point& p2);
 
-    std::vector<Point> convexHull() const;
-    double area() const;
+    const std::vector<Point>& convexHull() const { return hull_; }
+    double area() const { return area_; }
 
     const std::vector<Point>& getPoints() const { return points_; }
     const std::vector<std::pair<Point, Point>>& getEdges() const { return edges_; }
 
+    const PublishedArea& published() const { return published_; }
+    uint64_t version() const { return version_; }
+
+    // hold back publishing and the listener until the matching endBatch();
+    // batches nest, the outermost endBatch() publishes
+    void beginBatch() { ++batchDepth_; }
+    void endBatch();
+
+    // called after every change (or batch) that moved the hull, in order, by whoever
+    // changed the graph (so with its lock held); may read the graph but not
+    // change it
+    typedef void (*HullListener)(const Graph& g, void* arg);
+    void setHullListener(HullListener fn, void* arg) { listener_ = fn; listenerArg_ = arg; }
+
 private:
     std::vector<Point> points_;
     std::vector<std::pair<Point, Point>> edges_;
+    std::vector<Point> hull_;      // counterclockwise, as ComputeConvexHull leaves it
+    double area_ = 0.0;
+    uint64_t version_ = 0;
+    PublishedArea published_;
+    bool hullMoved_ = false;       // since the last changed()
+    int batchDepth_ = 0;
+    bool batchChanged_ = false;    // changed() was held back by the open batch
+    HullListener listener_ = nullptr;
+    void* listenerArg_ = nullptr;
+
     std::vector<Point> ComputeConvexHull(std::vector<Point>& pts) const;
     double ComputeArea(const std::vector<Point>& P) const;
     bool hasPoint(const Point& p) const;
+    bool inHull(const Point& p) const;
+    void removeHullVertex(size_t i);
+    void setHull(std::vector<Point> pts);
+    void changed();
 
 };
@@ -0,0 +1,94 @@
+#include "GraphCombiner.hpp"
+#include <thread>
+
+static constexpr int COMBINE_PASSES = 4;   // re-check for late arrivals before unlocking
+static constexpr int SPINS_BEFORE_YIELD = 64;
+
+bool GraphCombiner::apply(Op op, const Point& a, const Point& b) {
+    switch (op) {
+    case ADD_POINT:    return graph_.addPoint(a);
+    case REMOVE_POINT: return graph_.removePoint(a);
+    case ADD_EDGE:     return graph_.addEdge(a, b);
+    case REMOVE_EDGE:  return graph_.removeEdge(a, b);
+    }
+    return false;
+}
+
+bool GraphCombiner::submit(Op op, const Point& a, const Point& b) {
+    // uncontended: no need to publish, but serve whoever did
+    if (mtx_.try_lock()) {
+        graph_.beginBatch();
+        bool result = apply(op, a, b);
+        Request* served = combine();
+        graph_.endBatch();
+        release(served);
+        mtx_.unlock();
+        return result;
+    }
+
+    Request req;
+    req.op = op;
+    req.a = a;
+    req.b = b;
+    req.result = false;
+    req.done.store(false, std::memory_order_relaxed);
+    req.next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(req.next, &req, std::memory_order_release,
+                                        std::memory_order_relaxed)) {}
+
+    for (int spins = 0; ; ++spins) {
+        if (req.done.load(std::memory_order_acquire)) return req.result;
+        if (mtx_.try_lock()) {
+            graph_.beginBatch();
+            Request* served = combine();   // ours was published first, so it is in there
+            graph_.endBatch();
+            release(served);
+            mtx_.unlock();
+            continue;
+        }
+        if (spins < SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            std::this_thread::yield();   // let the combiner run
+        }
+    }
+}
+
+// Applies everything published meanwhile and hands the requests back in
+// the order they were applied; they stay unanswered until release(), so the
+// caller can close the graph batch first and nobody is told "done" before
+// the change is published.
+GraphCombiner::Request* GraphCombiner::combine() {
+    Request* served = nullptr;
+    Request** tail = &served;
+    for (int pass = 0; pass < COMBINE_PASSES; ++pass) {
+        if (!head_.load(std::memory_order_relaxed)) break;   // skip the RMW when idle
+        Request* list = head_.exchange(nullptr, std::memory_order_acquire);
+
+        // oldest first, so requests apply in the order they were published
+        Request* fifo = nullptr;
+        while (list) {
+            Request* next = list->next;
+            list->next = fifo;
+            fifo = list;
+            list = next;
+        }
+
+        *tail = fifo;
+        for (Request* r = fifo; r; r = r->next) {
+            r->result = apply(r->op, r->a, r->b);
+            tail = &r->next;
+        }
+    }
+    return served;
+}
+
+void GraphCombiner::release(Request* served) {
+    while (served) {
+        Request* r = served;
+        served = r->next;         // r may be gone as soon as done is set
+        r->done.store(true, std::memory_order_release);
+    }
+}
@@ -0,0 +1,54 @@
+#include "GraphRegistry.hpp"
+
+Tenant::Tenant(std::string_view n) : name(n), writer(graph, mtx) {
+    graph.setHullListener(&Tenant::onHullMoved, this);
+}
+
+void Tenant::onHullMoved(const Graph& g, void* arg) {
+    Tenant* t = static_cast<Tenant*>(arg);
+    if (t->monitor_) t->monitor_->publish(g.area());
+    if (t->feed_) t->feed_->publish(g.version(), g.area(), g.convexHull());
+}
+
+AreaMonitor* Tenant::monitor() {
+    if (!monitor_) {
+        std::unique_ptr<AreaMonitor> m(new AreaMonitor());
+        if (!m->start(graph.area())) return nullptr;
+        monitor_ = std::move(m);
+    }
+    return monitor_.get();
+}
+
+HullFeed* Tenant::feed() {
+    if (!feed_) {
+        std::unique_ptr<HullFeed> f(new HullFeed());
+        if (!f->start()) return nullptr;
+        feed_ = std::move(f);
+    }
+    return feed_.get();
+}
+
+void Tenant::stopWatchers() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (monitor_) monitor_->stop();
+    if (feed_) feed_->stop();
+}
+
+Tenant* GraphRegistry::get(std::string_view name) {
+    if (name.empty() || name.size() > MAX_NAME) return nullptr;
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::unordered_map<std::string, std::unique_ptr<Tenant>>::iterator it = graphs_.find(std::string(name));
+    if (it != graphs_.end()) return it->second.get();
+    if (graphs_.size() >= MAX_GRAPHS) return nullptr;
+    Tenant* t = new Tenant(name);
+    graphs_.emplace(t->name, std::unique_ptr<Tenant>(t));
+    return t;
+}
+
+std::vector<Tenant*> GraphRegistry::all() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<Tenant*> out;
+    out.reserve(graphs_.size());
+    for (auto& g : graphs_) out.push_back(g.second.get());
+    return out;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Graph.hpp"
+#include "GraphCombiner.hpp"
+#include "AreaMonitor.hpp"
+#include "HullFeed.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+// One named graph and everything that serializes access to it. Graphs
+// share no lock, so clients working on different graphs never wait on
+// each other.
+struct Tenant {
+    explicit Tenant(std::string_view name);
+
+    const std::string name;
+    Graph graph;
+    std::mutex mtx;          // graph, and the watchers below
+    GraphCombiner writer;    // Newpoint/Removepoint/Addedge/Removeedge
+
+    // The area monitor and hull feed of this graph, started on first use so
+    // that a graph nobody watches costs no threads. mtx held.
+    AreaMonitor* monitor();
+    HullFeed* feed();
+    // mtx held; nullptr if never started
+    AreaMonitor* monitorIfStarted() const { return monitor_.get(); }
+    HullFeed* feedIfStarted() const { return feed_.get(); }
+
+    void stopWatchers();
+
+private:
+    static void onHullMoved(const Graph& g, void* arg);   // mtx held
+
+    std::unique_ptr<AreaMonitor> monitor_;
+    std::unique_ptr<HullFeed> feed_;
+};
+
+// Graphs by name, created empty on first use. Lookups take one mutex, but
+// a connection does one per Use and keeps the Tenant*: tenants are never
+// removed, so the pointer stays good for the registry's lifetime.
+class GraphRegistry {
+public:
+    // Tenants are never freed and each can start two watcher threads, so
+    // this bounds what clients can make the server hold
+    static constexpr size_t MAX_GRAPHS = 1024;
+    static constexpr size_t MAX_NAME = 64;
+
+    // nullptr if the name is empty or too long, or MAX_GRAPHS exist already
+    Tenant* get(std::string_view name);
+
+    std::vector<Tenant*> all();
+
+private:
+    std::mutex mtx_;
+    std::unordered_map<std::string, std::unique_ptr<Tenant>> graphs_;
+};
@@ -0,0 +1,163 @@
+#include "HullFeed.hpp"
+#include "ReplyWriter.hpp"
+#include <algorithm>
+#include <string>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+static constexpr long FEED_INTERVAL_MS = 5;     // at most one round of diffs per interval
+static constexpr int BACKLOG_RETRY_MS = 10;     // how soon a subscriber that was behind is looked at again
+
+HullFeed::HullFeed()
+    : subscribers_(0), dirty_(false), sleeping_(false), stop_(false), wakeFd_(-1) {
+    empty_ = makeState(UINT64_MAX, 0.0, std::vector<Point>());   // no graph version matches it
+}
+
+HullFeed::~HullFeed() {
+    stop();
+}
+
+bool HullFeed::start() {
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd_ < 0) return false;
+    try {
+        thread_ = std::thread(&HullFeed::run, this);
+    } catch (...) {
+        close(wakeFd_);
+        wakeFd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+void HullFeed::stop() {
+    if (!thread_.joinable()) return;
+    stop_.store(true);
+    uint64_t one = 1;
+    (void)!write(wakeFd_, &one, sizeof(one));
+    thread_.join();
+    close(wakeFd_);
+    wakeFd_ = -1;
+}
+
+HullFeed::StatePtr HullFeed::makeState(uint64_t version, double area, const std::vector<Point>& hull) {
+    std::shared_ptr<State> s = std::make_shared<State>();
+    s->version = version;
+    s->area = area;
+    s->hull = hull;
+    std::sort(s->hull.begin(), s->hull.end());
+    return s;
+}
+
+void HullFeed::publish(uint64_t version, double area, const std::vector<Point>& hull) {
+    if (subscribers_.load(std::memory_order_acquire) == 0) return;
+    StatePtr s = makeState(version, area, hull);
+    {
+        std::lock_guard<std::mutex> lock(latestMtx_);
+        latest_.swap(s);
+    }
+    dirty_.store(true, std::memory_order_relaxed);
+    // pairs with the fence in run(): either it sees dirty_ or we see it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) {
+        uint64_t one = 1;
+        (void)!write(wakeFd_, &one, sizeof(one));
+    }
+}
+
+bool HullFeed::subscribe(ReplyBatch* sub, uint64_t version, double area, const std::vector<Point>& hull) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (const Subscriber& s : subs_) {
+            if (s.sub == sub) return false;
+        }
+        subs_.push_back(Subscriber{sub, empty_});
+        subscribers_.fetch_add(1, std::memory_order_release);
+    }
+    // publish() skipped everything while nobody listened; this is current
+    publish(version, area, hull);
+    return true;
+}
+
+bool HullFeed::unsubscribe(ReplyBatch* sub) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (size_t i = 0; i < subs_.size(); ++i) {
+        if (subs_[i].sub != sub) continue;
+        subs_.erase(subs_.begin() + i);
+        subscribers_.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+bool HullFeed::sendDiffs(const StatePtr& latest) {
+    bool behind = false;
+    std::string line;
+    for (Subscriber& s : subs_) {
+        if (s.sent == latest || s.sent->version == latest->version) continue;
+        // still sending the last one: skip it, the next diff covers both
+        if (!s.sub->drainPushed()) {
+            behind = true;
+            continue;
+        }
+
+        if (s.sent->hull == latest->hull) {   // changes that undid each other
+            s.sent = latest;
+            continue;
+        }
+        line.clear();
+        ReplyWriter out(line);
+        out << "Event hull " << latest->version << ": area = " << latest->area;
+        const std::vector<Point>& was = s.sent->hull;
+        const std::vector<Point>& now = latest->hull;
+        std::vector<Point> d;
+        std::set_difference(now.begin(), now.end(), was.begin(), was.end(), std::back_inserter(d));
+        for (const Point& p : d) out << " +" << p.x << ',' << p.y;
+        d.clear();
+        std::set_difference(was.begin(), was.end(), now.begin(), now.end(), std::back_inserter(d));
+        for (const Point& p : d) out << " -" << p.x << ',' << p.y;
+        out << '\n';
+
+        s.sub->push(line);   // the backlog is empty, so it is taken
+        s.sent = latest;
+        if (!s.sub->drainPushed()) behind = true;
+    }
+    return behind;
+}
+
+void HullFeed::run() {
+    while (!stop_.load()) {
+        dirty_.store(false, std::memory_order_relaxed);
+        StatePtr latest;
+        {
+            std::lock_guard<std::mutex> lock(latestMtx_);
+            latest = latest_;
+        }
+        bool behind = false;
+        if (latest) {
+            std::lock_guard<std::mutex> lock(mtx_);
+            behind = sendDiffs(latest);
+        }
+
+        // let changes pile up into one diff rather than send each of them
+        timespec nap = {0, FEED_INTERVAL_MS * 1000000};
+        nanosleep(&nap, nullptr);
+        if (dirty_.load(std::memory_order_relaxed)) continue;
+
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (dirty_.load(std::memory_order_relaxed) || stop_.load()) {
+            sleeping_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        pollfd p{wakeFd_, POLLIN, 0};
+        int rc = poll(&p, 1, behind ? BACKLOG_RETRY_MS : -1);
+        sleeping_.store(false, std::memory_order_relaxed);
+        if (rc > 0) {
+            uint64_t v;
+            (void)!read(wakeFd_, &v, sizeof(v));
+        }
+    }
+}
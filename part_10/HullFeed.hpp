@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Point.hpp"
+#include "ReplyBatch.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+
+// Hull changes streamed to Subscribe'd connections, one line per update:
+//
+//     Event hull <version>: area = <area> +x,y ... -x,y ...
+//
+// listing the vertices that joined (+) and left (-) the hull since the
+// last line that subscriber got. The first line after Subscribe lists the
+// whole hull, once there is one; changes that cancel out send nothing.
+//
+// The graph writer publish()es each new hull (with its lock held, so in
+// order); the feed thread looks at most once per FEED_INTERVAL_MS. Every
+// subscriber remembers the hull it was last sent, and only gets a new line
+// once its previous ones have left the socket: a slow subscriber never
+// queues up diffs, it gets one diff from where it was to wherever the
+// graph is by then.
+class HullFeed {
+public:
+    HullFeed();
+    ~HullFeed();
+
+    bool start();
+    void stop();
+
+    // graph writer, lock held; next to nothing while nobody subscribes
+    void publish(uint64_t version, double area, const std::vector<Point>& hull);
+
+    // graph lock held, so the hull given is the current one; false if sub
+    // already subscribes
+    bool subscribe(ReplyBatch* sub, uint64_t version, double area, const std::vector<Point>& hull);
+    // no push reaches sub after this returns; false if it didn't subscribe
+    bool unsubscribe(ReplyBatch* sub);
+
+private:
+    struct State {
+        uint64_t version;
+        double area;
+        std::vector<Point> hull;   // sorted by Point::operator<, for diffing
+    };
+    typedef std::shared_ptr<const State> StatePtr;
+
+    struct Subscriber {
+        ReplyBatch* sub;
+        StatePtr sent;
+    };
+
+    static StatePtr makeState(uint64_t version, double area, const std::vector<Point>& hull);
+    void run();
+    bool sendDiffs(const StatePtr& latest);   // mtx_ held; true if some subscriber is behind
+
+    std::atomic<int> subscribers_;
+    std::mutex latestMtx_;         // latest_
+    StatePtr latest_;
+    std::atomic<bool> dirty_;      // latest_ moved since the feed last looked
+
+    std::mutex mtx_;               // subs_
+    std::vector<Subscriber> subs_;
+    StatePtr empty_;
+
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> stop_;
+    int wakeFd_;
+    std::thread thread_;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+
+// Buffered line reader for one socket. It pulls whatever the kernel has
+// (up to a chunk) per recv() and hands out lines as views into its own
+// buffer, so a line costs no syscall of its own and no copy.
+//
+// A view stays valid until the next call that reads from the socket
+// (readLine() or fill()); copy it if it has to live longer. Views are
+// NUL-terminated in place of the '\n', and a trailing '\r' is dropped.
+//
+// A line that grows past maxLine without its '\n' is an error (EMSGSIZE)
+// rather than more buffer, so a peer can't make the reader take all memory.
+class LineReader {
+public:
+    static constexpr size_t MAX_LINE = 1 << 20;
+    static constexpr size_t NO_LIMIT = (size_t)-1;
+
+    explicit LineReader(int fd, size_t chunk = 64 * 1024, size_t maxLine = MAX_LINE);
+
+    // Blocking style: the next line, reading from the socket as needed.
+    // false on EOF or error; a trailing partial line is dropped.
+    bool readLine(std::string_view& line);
+
+    // Event-loop style: one recv() into the buffer (>0 bytes read, 0 EOF,
+    // <0 error, including a line over maxLine), then nextLine() until it
+    // returns false. flags go to recv(): with MSG_DONTWAIT, <0 and EAGAIN
+    // means nothing has arrived yet.
+    ssize_t fill(int flags = 0);
+    bool nextLine(std::string_view& line);
+
+    // true if a whole line is already buffered, so readLine() won't block
+    bool hasLine();
+
+    int fd() const { return fd_; }
+
+private:
+    int fd_;
+    size_t chunk_;
+    size_t maxLine_;
+    std::vector<char> buf_;
+    size_t start_ = 0;      // first byte not yet handed out
+    size_t scanned_ = 0;    // [start_, scanned_) is known to hold no '\n'
+    size_t end_ = 0;        // one past the last byte received
+};
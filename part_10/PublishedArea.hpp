@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+
+// The graph's (version, area), readable without the graph lock.
+//
+// A seqlock: the one writer (whoever holds the graph lock) makes the
+// sequence odd, stores, and makes it even again; a reader retries until it
+// saw the same even sequence before and after. Readers never write to the
+// shared line, so any number of them cost the writer nothing.
+class PublishedArea {
+public:
+    void store(uint64_t version, double area) {
+        uint64_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        version_.store(version, std::memory_order_relaxed);
+        area_.store(area, std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    double load(uint64_t* version = nullptr) const {
+        for (;;) {
+            uint64_t s = seq_.load(std::memory_order_acquire);
+            uint64_t v = version_.load(std::memory_order_relaxed);
+            double a = area_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((s & 1) == 0 && seq_.load(std::memory_order_relaxed) == s) {
+                if (version) *version = v;
+                return a;
+            }
+        }
+    }
+
+private:
+    std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> version_{0};
+    std::atomic<double> area_{0.0};
+};
@@ -0,0 +1,57 @@
+#include "ReplyBatch.hpp"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static bool writeAll(int fd, const char* p, size_t left) {
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        left -= n;
+    }
+    return true;
+}
+
+bool ReplyBatch::flush() {
+    std::lock_guard<std::mutex> lock(writeMtx_);
+    std::string pending;
+    {
+        std::lock_guard<std::mutex> plock(pushMtx_);
+        pending.swap(pushed_);
+    }
+    bool ok = writeAll(fd_, pending.data(), pending.size()) && writeAll(fd_, buf_.data(), buf_.size());
+    buf_.clear();   // keeps the capacity
+    return ok;
+}
+
+bool ReplyBatch::push(std::string_view msg) {
+    std::lock_guard<std::mutex> lock(pushMtx_);
+    if (pushed_.size() > PUSH_BACKLOG_MAX) return false;
+    pushed_.append(msg.data(), msg.size());
+    return true;
+}
+
+bool ReplyBatch::drainPushed() {
+    // the connection thread is writing: it takes the backlog with it, or
+    // leaves it for the next try
+    std::unique_lock<std::mutex> lock(writeMtx_, std::try_to_lock);
+    std::lock_guard<std::mutex> plock(pushMtx_);
+    if (!lock.owns_lock()) return pushed_.empty();
+
+    size_t sent = 0;
+    while (sent < pushed_.size()) {
+        ssize_t n = send(fd_, pushed_.data() + sent, pushed_.size() - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) sent = pushed_.size();   // peer gone: drop it
+            break;
+        }
+        sent += n;
+    }
+    pushed_.erase(0, sent);
+    return pushed_.empty();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <string_view>
+
+
+// Replies produced while working through one read batch. They pile up in
+// one buffer and go out together once the batch is used up, so a client
+// that pipelines K requests gets its K replies in one segment instead of
+// K sends. The buffer is kept across flushes; handlers format straight
+// into it (see ReplyWriter) and stop allocating once it has grown.
+//
+// Other threads can push lines that answer nothing (area events) onto the
+// same socket. A push never blocks: what the socket won't take now waits
+// in a backlog that goes out ahead of the next flush, or on a later
+// drainPushed(). Whole lines only ever reach the socket, never interleaved.
+class ReplyBatch {
+public:
+    explicit ReplyBatch(int fd) : fd_(fd) {}
+
+    void add(std::string_view reply) { buf_.append(reply.data(), reply.size()); }
+
+    std::string& buffer() { return buf_; }
+
+    // Sends everything queued; false once the peer is gone.
+    bool flush();
+
+    // any thread: queues msg behind what is already pushed; false (and msg
+    // dropped) if the backlog is already over PUSH_BACKLOG_MAX
+    bool push(std::string_view msg);
+    // any thread: sends what of the backlog the socket takes without
+    // blocking; true once nothing is left
+    bool drainPushed();
+
+    static constexpr size_t PUSH_BACKLOG_MAX = 64 * 1024;
+
+private:
+    int fd_;
+    std::string buf_;
+    std::mutex writeMtx_;    // one writer on the socket at a time
+    std::mutex pushMtx_;     // pushed_
+    std::string pushed_;
+};
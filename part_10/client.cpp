@@ -1,14 +1,18 @@
+#include "LineReader.hpp"
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <cstring>
+#include <cstdlib>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 
 static constexpr int PORT = 9034;
 static constexpr const char* HOST = "127.0.0.1";
+static constexpr const char* UNIX_PATH = "/tmp/graph_server.sock";
 
 // Send a line (with trailing '\n') to the socket
 bool sendLine(int sock, const std::string& line) {
@@ -27,41 +31,153 @@ bool sendLine(int sock, const std::string& line) {
     return true;
 }
 
-// Receive up to bufSize-1 bytes, null-terminate, and print
-bool recvAndPrint(int sock) {
-    std::string line;
-    line.reserve(256);
-    char c;
-    for(;;) {
-        ssize_t n = recv(sock, &c, 1, 0);
-        if (n < 0) { perror("recv"); return false; }
-        if (n == 0) { std::cout<<"<server closed>\n"; return false; }
-        line.push_back(c);
-        if (c == '\n') break;
-        if (c == '\r') line.push_back(c);
+// Print the server's next reply line, and any Event lines (pushed by
+// watches, not replies to anything) that arrive ahead of it
+bool recvAndPrint(LineReader& reader) {
+    std::string_view line;
+    do {
+        if (!reader.readLine(line)) { std::cout<<"<server closed>\n"; return false; }
+        std::cout << line << '\n';
+    } while (line.substr(0, 6) == "Event ");
+    return true;
+}
+
+// Send already-framed bytes as they are
+bool sendRaw(int sock, const std::string& data) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t sent = send(sock, p, left, 0);
+        if (sent < 0) {
+            perror("send");
+            return false;
+        }
+        p    += sent;
+        left -= sent;
     }
-    std::cout << line;
     return true;
 }
 
-int main() {
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) { perror("socket"); return 1; }
+// Begin ... Commit goes out as one block and gets one reply per line in it
+// plus the final Committed / Aborted. Appends the block (its Begin line is
+// already in out) and returns how many replies to expect.
+int appendBlock(std::string& out) {
+    std::string line;
+    int replies = 1;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) continue;
+        out += line;
+        out += '\n';
+        std::istringstream iss(line);
+        std::string cmd;
+        iss >> cmd;
+        if (cmd == "Commit") return replies;
+        ++replies;
+    }
+    out += "Commit\n";     // input ended mid-block: close it
+    return replies;
+}
 
-    sockaddr_in serv{};
-    serv.sin_family = AF_INET;
-    serv.sin_port   = htons(PORT);
-    if (inet_pton(AF_INET, HOST, &serv.sin_addr) <= 0) {
-        std::cerr << "Invalid address\n";
-        return 1;
+// Pipelined mode: keep up to `depth` requests in flight. Requests are
+// written in one send per window top-up and replies are printed as they
+// arrive, in order.
+void runPipelined(int sock, LineReader& reader, int depth) {
+    std::string out, line;
+    int inflight = 0;
+    bool eof = false;
+    while (!eof || inflight > 0) {
+        while (!eof && inflight < depth) {
+            if (!std::getline(std::cin, line)) { eof = true; break; }
+            if (line.empty()) continue;
+            out += line;
+            out += '\n';
+
+            std::istringstream iss(line);
+            std::string cmd;
+            int n = 0;
+            iss >> cmd;
+            if (cmd == "Begin") {
+                inflight += appendBlock(out);
+                continue;
+            }
+            if (cmd == "Newgraph" && (iss >> n)) {
+                for (int i = 0; i < n && std::getline(std::cin, line); ++i) {
+                    if (line.empty()) { --i; continue; }
+                    out += line;
+                    out += '\n';
+                }
+            }
+            ++inflight;
+        }
+        if (!out.empty()) {
+            if (!sendRaw(sock, out)) return;
+            out.clear();
+        }
+        if (inflight == 0) break;
+
+        // at least one reply, then every one that has already arrived
+        do {
+            if (!recvAndPrint(reader)) return;
+            --inflight;
+        } while (inflight > 0 && reader.hasLine());
     }
-    if (connect(sock, (sockaddr*)&serv, sizeof(serv)) < 0) {
-        perror("connect");
+}
+
+int main(int argc, char** argv) {
+    // -p K: pipeline, keeping K requests in flight (default 1: lock-step);
+    // -u: connect over the Unix socket instead of TCP
+    int depth = 1;
+    bool useUnix = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-u")) useUnix = true;
+        else depth = 0;
+    }
+    if (depth < 1) {
+        std::cerr << "usage: " << argv[0] << " [-p depth] [-u]\n";
         return 1;
     }
 
-    std::cout << "Connected to " << HOST << ":" << PORT 
-              << "\nType commands, Ctrl-D to exit.\n";
+    int sock;
+    if (useUnix) {
+        sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sock < 0) { perror("socket"); return 1; }
+
+        sockaddr_un serv{};
+        serv.sun_family = AF_UNIX;
+        strncpy(serv.sun_path, UNIX_PATH, sizeof(serv.sun_path) - 1);
+        if (connect(sock, (sockaddr*)&serv, sizeof(serv)) < 0) {
+            perror("connect");
+            return 1;
+        }
+        std::cout << "Connected to " << UNIX_PATH;
+    } else {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0) { perror("socket"); return 1; }
+
+        sockaddr_in serv{};
+        serv.sin_family = AF_INET;
+        serv.sin_port   = htons(PORT);
+        if (inet_pton(AF_INET, HOST, &serv.sin_addr) <= 0) {
+            std::cerr << "Invalid address\n";
+            return 1;
+        }
+        if (connect(sock, (sockaddr*)&serv, sizeof(serv)) < 0) {
+            perror("connect");
+            return 1;
+        }
+        std::cout << "Connected to " << HOST << ":" << PORT;
+    }
+    std::cout << "\nType commands, Ctrl-D to exit.\n";
+
+    // Subscribe lines carry a whole hull, and the server is trusted anyway
+    LineReader reader(sock, 64 * 1024, LineReader::NO_LIMIT);
+    if (depth > 1) {
+        runPipelined(sock, reader, depth);
+        close(sock);
+        std::cout << "Client exiting\n";
+        return 0;
+    }
 
     std::string line;
     while (std::getline(std::cin, line)) {
@@ -72,6 +188,16 @@ int main() {
         std::string cmd;
         iss >> cmd;
 
+        if (cmd == "Begin") {
+            std::string block = line + "\n";
+            int replies = appendBlock(block);
+            if (!sendRaw(sock, block)) break;
+            bool ok = true;
+            for (int i = 0; i < replies && ok; ++i) ok = recvAndPrint(reader);
+            if (!ok) break;
+            continue;
+        }
+
         // Send the header line
         if (!sendLine(sock, line)) break;
 
@@ -93,7 +219,7 @@ int main() {
         }
 
         // Now wait for and print the server's reply
-        if (!recvAndPrint(sock)) break;
+        if (!recvAndPrint(reader)) break;
     }
 
     close(sock);
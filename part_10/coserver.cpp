@@ -0,0 +1,320 @@
+#include "Graph.hpp"
+#include "AreaMonitor.hpp"
+#include "reactor.hpp"
+#include "coro.hpp"
+#include "CommandTable.hpp"
+#include "ReplyWriter.hpp"
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string_view>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <fstream>
+#include <cstdio>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Same protocol and area monitor as server.cpp, but every client is a
+// coroutine on the reactor thread instead of a proactor thread. Watch and
+// Subscribe are not served here: the monitor only logs.
+
+static constexpr int PORT = 9034;
+static constexpr const char* SNAPSHOT_PATH = "graph.snapshot";
+static constexpr int DRAIN_TIMEOUT_MS = 5000;
+
+// only touched from the reactor thread, so no graphMutex
+static Graph graph;
+static void* gReactor = nullptr;
+
+static constexpr double AREA_LOG_LEVEL = 100.0;
+static AreaMonitor gMonitor;
+
+// reactor thread only
+static std::unordered_set<int> gClients;
+static int gListenFd = -1;
+static bool gDraining = false;
+
+// main sleeps on this until the drain is over
+static std::mutex gExitMtx;
+static std::condition_variable gExitCv;
+static bool gDrainStarted = false;
+static bool gDrained = false;
+
+
+static void signalExit(bool drained) {
+    std::lock_guard<std::mutex> lock(gExitMtx);
+    gDrainStarted = true;
+    if (drained) gDrained = true;
+    gExitCv.notify_one();
+}
+
+// The rest answer without waiting, so they are plain functions: append to
+// reply (it arrives empty), return false to end the connection. args is
+// what follows the name.
+typedef bool (*CommandHandler)(std::string_view args, std::string& reply);
+
+static bool onCH(std::string_view, std::string& reply) {
+    double area = graph.area();
+    ReplyWriter(reply) << "Area = " << area << "\n";
+    return true;
+}
+
+static bool onNewpoint(std::string_view args, std::string& reply) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        reply = "Invalid point format\n";
+        return true;
+    }
+    if (!graph.addPoint(Point{x, y})) {
+        reply = "Failed to add point (duplicate)\n";
+        return true;
+    }
+    ReplyWriter(reply) << "Point added: " << x << "," << y << "\n";
+    return true;
+}
+
+static bool onRemovepoint(std::string_view args, std::string& reply) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        reply = "Invalid point format\n";
+        return true;
+    }
+    if (!graph.removePoint(Point{x, y})) {
+        reply = "Failed to remove point (not found)\n";
+        return true;
+    }
+    ReplyWriter(reply) << "Point removed: " << x << "," << y << "\n";
+    return true;
+}
+
+static bool onAddedge(std::string_view args, std::string& reply) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char comma1, comma2;
+    in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+    if (!graph.addEdge(Point{x1, y1}, Point{x2, y2})) {
+        reply = "Failed to add edge (duplicate)\n";
+        return true;
+    }
+    ReplyWriter(reply) << "Edge added: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
+    return true;
+}
+
+static bool onRemoveedge(std::string_view args, std::string& reply) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char comma1, comma2;
+    in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+    if (!graph.removeEdge(Point{x1, y1}, Point{x2, y2})) {
+        reply = "Failed to remove edge (not found)\n";
+        return true;
+    }
+    ReplyWriter(reply) << "Edge removed: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
+    return true;
+}
+
+static bool onUnknown(std::string_view, std::string& reply) {
+    reply = "Unknown command\n";
+    return false;
+}
+
+static constexpr CommandDispatch<CommandHandler> COMMANDS{onUnknown, {
+    {CMD_CH, onCH},
+    {CMD_NEWPOINT, onNewpoint},
+    {CMD_REMOVEPOINT, onRemovepoint},
+    {CMD_ADDEDGE, onAddedge},
+    {CMD_REMOVEEDGE, onRemoveedge},
+}};
+
+static coTask handleClient(int clientSocket) {
+    gClients.insert(clientSocket);
+    std::string reply;                 // reused for every request on this connection
+    // once draining, finish the request in hand and take no more
+    while (!gDraining) {
+        std::optional<std::string> next = co_await readLine(clientSocket);
+        if (!next) break;
+        std::string line = *next;
+        if (line.empty()) continue;
+        std::string_view args;
+        Command cmd = lookupCommand(splitCommand(line, args));
+
+        // the one command that waits for more input, so it stays in the coroutine
+        if (cmd == CMD_NEWGRAPH) {
+            std::istringstream in{std::string(args)};
+            int n; in >> n;
+            std::vector<Point> pts;
+            bool readOk = true;
+
+            for (int i = 0; i < n; ++i) {
+                std::optional<std::string> ptLine = co_await readLine(clientSocket);
+                if (!ptLine) {
+                    readOk = false;
+                    break;
+                }
+                if (ptLine->empty()) { i--; continue; }
+                double x, y; char comma;
+                std::istringstream ptin(*ptLine);
+                if (!(ptin >> x >> comma >> y) || comma != ',') {
+                    reply.clear();
+                    ReplyWriter(reply) << "Invalid point format: " << *ptLine << "\n";
+                    readOk = false;
+                    co_await writeAll(clientSocket, reply);
+                    break;
+                }
+                pts.emplace_back(Point{x,y});
+            }
+            if (readOk) {
+                graph.newGraph(pts);
+                co_await writeAll(clientSocket, "New graph created\n");
+            }
+            continue;
+        }
+
+        reply.clear();
+        bool keep = COMMANDS.handlers[cmd](args, reply);
+        co_await writeAll(clientSocket, reply);
+        if (!keep) break;
+    }
+    gClients.erase(clientSocket);
+    coClose(clientSocket);
+    if (gDraining && gClients.empty()) signalExit(true);
+}
+
+static void* onAccept(int fd) {
+    // nonblocking: a client that stops reading must not stall the reactor
+    int clientfd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (clientfd < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "accept: %m");
+        return nullptr;
+    }
+    if (coSpawn(gReactor, clientfd, handleClient) < 0) close(clientfd);
+    return nullptr;
+}
+
+// Newgraph form, so the file can be replayed through a client
+static bool writeSnapshot(const char* path) {
+    std::string tmp = std::string(path) + ".tmp";
+    {
+        std::ofstream out(tmp.c_str());
+        if (!out) return false;
+        const std::vector<Point>& pts = graph.getPoints();
+        out << "Newgraph " << pts.size() << "\n";
+        for (size_t i = 0; i < pts.size(); ++i) out << pts[i].x << "," << pts[i].y << "\n";
+        if (!out.flush()) return false;
+    }
+    return std::rename(tmp.c_str(), path) == 0;
+}
+
+// Graceful stop: every handler finishes the request it is on and closes.
+// Idle ones are parked in readLine, so half-close them to wake them up.
+static void startDrain() {
+    if (gDraining) return;
+    gDraining = true;
+    removeFdFromReactor(gReactor, gListenFd);
+    for (int fd : gClients) shutdown(fd, SHUT_RD);
+    signalExit(gClients.empty());
+}
+
+static void* onSignal(int sigfd) {
+    int sig;
+    while ((sig = readSignal(sigfd)) > 0) {
+        if (sig == SIGHUP) {
+            if (writeSnapshot(SNAPSHOT_PATH)) logPrintf(LOG_LEVEL_INFO, "Snapshot written to %s", SNAPSHOT_PATH);
+            else logPrintf(LOG_LEVEL_ERROR, "Error writing snapshot");
+        } else {
+            logPrintf(LOG_LEVEL_INFO, "Draining connections...");
+            startDrain();
+        }
+    }
+    return nullptr;
+}
+
+int main() {
+
+    signal(SIGPIPE, SIG_IGN);
+    // before any thread exists, so none of them ever takes these signals
+    const int sigs[] = {SIGINT, SIGTERM, SIGHUP};
+    int sigfd = openSignalFd(sigs, 3);
+    if (sigfd < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error creating signalfd");
+        return 1;
+    }
+    // after the signal mask is set, so the flusher thread inherits it; atexit
+    // writes out whatever is still queued on every way out of main
+    if (startLogger(LOG_LEVEL_INFO) == 0) atexit(stopLogger);
+
+    logPrintf(LOG_LEVEL_INFO, "Starting Graph server on port %d...", PORT);
+
+    int listenfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenfd < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error creating socket");
+        return 1;
+    }
+    sockaddr_in serverAddr{};
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    serverAddr.sin_port = htons(PORT);
+
+    int yes = 1;
+    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    if (bind(listenfd, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error binding socket");
+        close(listenfd);
+        return 1;
+    }
+
+    if (listen(listenfd, SOMAXCONN) < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error listening on socket");
+        close(listenfd);
+        return 1;
+    }
+
+    if (!gMonitor.start()) {
+        logPrintf(LOG_LEVEL_ERROR, "Error starting area monitor");
+        close(listenfd);
+        return 1;
+    }
+    bool above;
+    gMonitor.watch(nullptr, AREA_LOG_LEVEL, 0, above);
+    graph.setHullListener([](const Graph& g, void*) { gMonitor.publish(g.area()); }, nullptr);
+
+    gReactor = startReactor();
+    if (!gReactor) {
+        logPrintf(LOG_LEVEL_ERROR, "Error starting reactor");
+        close(listenfd);
+        return 1;
+    }
+    gListenFd = listenfd;
+    addFdToReactor(gReactor, listenfd, onAccept);
+    addFdToReactor(gReactor, sigfd, onSignal);
+
+    {
+        std::unique_lock<std::mutex> lock(gExitMtx);
+        while (!gDrainStarted) gExitCv.wait(lock);
+        if (!gExitCv.wait_for(lock, std::chrono::milliseconds(DRAIN_TIMEOUT_MS),
+                              [] { return gDrained; })) {
+            logPrintf(LOG_LEVEL_WARN, "Drain timed out, closing remaining connections");
+        }
+    }
+
+    logPrintf(LOG_LEVEL_INFO, "Shutting down reactor...");
+    stopReactor(gReactor);
+    logPrintf(LOG_LEVEL_INFO, "Reactor stopped");
+
+    gMonitor.stop();
+    close(listenfd);
+    close(sigfd);
+    return 0;
+
+}
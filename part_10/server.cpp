@@ -1,231 +1,509 @@
 #include "Graph.hpp"
+#include "GraphRegistry.hpp"
+#include "LineReader.hpp"
+#include "CommandTable.hpp"
+#include "ReplyWriter.hpp"
+#include "ReplyBatch.hpp"
 #include "reactor.hpp"
-#include <iostream>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <string_view>
+#include <cstdlib>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
 #include <unistd.h>
 #include <mutex>
 #include <pthread.h>
 #include <signal.h>
+#include <poll.h>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
 
 
 static constexpr int PORT = 9034;
+static constexpr const char* UNIX_PATH = "/tmp/graph_server.sock";
+static constexpr int MAX_CONNS = 1024;
+static constexpr double CONN_RATE_PER_SOURCE = 200.0;  // new connections per second
+static constexpr int CONN_BURST_PER_SOURCE = 400;
+static constexpr const char* SNAPSHOT_PATH = "graph.snapshot";
+static constexpr size_t MAX_TXN_OPS = 1 << 16;   // lines one Begin block may hold
+
+static constexpr const char* DEFAULT_GRAPH = "default";   // where a connection starts
+static constexpr double AREA_LOG_LEVEL = 100.0;   // default graph crossings logged by the server itself
+
+static GraphRegistry gGraphs;
+static Tenant* gDefault = nullptr;
+
+// "x,y" straight out of a reader line (which is NUL-terminated), no
+// stream; accepts what `in >> x >> comma >> y` did
+static bool parsePoint(std::string_view line, double& x, double& y) {
+    const char* p = line.data();
+    char* end;
+    x = strtod(p, &end);
+    if (end == p || !std::isfinite(x)) return false;
+    p = end;
+    while (*p == ' ' || *p == '	') ++p;
+    if (*p++ != ',') return false;
+    y = strtod(p, &end);
+    return end != p && std::isfinite(y);
+}
 
-Graph graph;
-std::mutex graphMutex;
+// what a command handler works with, on the connection's own thread
+struct Session {
+    int fd;
+    LineReader& reader;
+    ReplyBatch& replies;
+    Tenant* g;                      // the graph commands work on (Use)
+    std::vector<Tenant*> watching;  // graphs this connection has watches or a feed on
+};
+
+// one per command; false ends the connection. args is what follows the name.
+typedef bool (*CommandHandler)(Session& s, std::string_view args);
+
+static bool onNewgraph(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    int n; in >> n;
+    std::vector<Point> pts;
+    std::string_view line;
+    bool readOk = true;
+
+    for (int i = 0; i < n; ++i) {
+        if (!s.reader.hasLine()) s.replies.flush();
+        if (!s.reader.readLine(line)){
+            readOk = false;
+            break;
+        } 
+        if (line.empty()) { i--; continue; }
+        double x, y;
+        if (!parsePoint(line, x, y)) {
+            readOk = false;
+            ReplyWriter(s.replies.buffer()) << "Invalid point format: " << line << "\n";
+            break;
+        }
+        pts.emplace_back(Point{x,y});
+    }
+    if(readOk){
+        std::lock_guard<std::mutex> lock(s.g->mtx);
+        s.g->graph.newGraph(pts);
+        s.replies.add("New graph created\n");
+    }
+    return true;
+}
 
-static pthread_mutex_t gMonMtx = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t gMonCv = PTHREAD_COND_INITIALIZER;
+// the graph keeps its area current and publishes it, so CH needs no lock
+static bool onCH(Session& s, std::string_view) {
+    double area = s.g->graph.published().load();
+    ReplyWriter(s.replies.buffer()) << "Area = " << area << "\n";
+    return true;
+}
 
-static double gLastArea = 0.0;
-static bool gHasUpdated = false;
-static bool gAtLeast100 = false;
-static bool gShuttingDown = false;
+static bool onNewpoint(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        s.replies.add("Invalid point format\n");
+        return true;
+    }
 
-static volatile sig_atomic_t gStopFlag = 0;
-static void on_stop(int) {
-    gStopFlag = 1;
+    if (!s.g->writer.addPoint(Point{x, y})) {
+        s.replies.add("Failed to add point (duplicate)\n");
+        return true;
+    }
+    ReplyWriter(s.replies.buffer()) << "Point added: " << x << "," << y << "\n";
+    return true;
 }
 
+static bool onRemovepoint(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        s.replies.add("Invalid point format\n");
+        return true;
+    }
 
-bool recvLine(int fd, std::string& line) {
-    line.clear();
-    char c;
-    while (true) {
-        ssize_t n = recv(fd, &c, 1, 0);
-        if (n <= 0) return false; // Error or connection closed
-        if (c == '\n') break;
-        if (c != '\r') line.push_back(c);
+    if (!s.g->writer.removePoint(Point{x, y})) {
+        s.replies.add("Failed to remove point (not found)\n");
+        return true;
     }
-    return true; // Successfully received a line
+    ReplyWriter(s.replies.buffer()) << "Point removed: " << x << "," << y << "\n";
+    return true;
 }
 
-void sendAll(int fd, const std::string& message) {
-    const char* msg = message.data();
-    size_t msgLength = message.size();
-    while(msgLength > 0) {
-        ssize_t n = send(fd, msg, msgLength, 0);
-        if (n < 0) {
-            std::cerr << "Error sending data\n";
-            return; // Handle error appropriately
-        }
-        msg += n;
-        msgLength -= n;
+static bool onAddedge(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char comma1, comma2;
+    in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+    if (!s.g->writer.addEdge(Point{x1, y1}, Point{x2, y2})) {
+        s.replies.add("Failed to add edge (duplicate)\n");
+        return true;
     }
+    ReplyWriter(s.replies.buffer()) << "Edge added: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
+    return true;
 }
 
-static void* monitorArea(void*){
-    pthread_mutex_lock(&gMonMtx);
-    while (!gShuttingDown) {
-        while (!gHasUpdated && !gShuttingDown)
-            pthread_cond_wait(&gMonCv, &gMonMtx);
+static bool onRemoveedge(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char comma1, comma2;
+    in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+    if (!s.g->writer.removeEdge(Point{x1, y1}, Point{x2, y2})) {
+        s.replies.add("Failed to remove edge (not found)\n");
+        return true;
+    }
+    ReplyWriter(s.replies.buffer()) << "Edge removed: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
+    return true;
+}
 
-        if (gShuttingDown) break;
+// one line of a Begin/Commit block, parsed before anything is applied
+struct TxnOp {
+    Command cmd;
+    Point a, b;
+    const char* error;   // set if the line can't go into a transaction
+    bool ok;
+    double area;
+};
+
+static const char* parseTxnOp(TxnOp& op, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    char c1, c2;
+    switch (op.cmd) {
+    case CMD_NEWPOINT:
+    case CMD_REMOVEPOINT:
+        if (!(in >> op.a.x >> c1 >> op.a.y) || c1 != ',') return "Invalid point format\n";
+        return nullptr;
+    case CMD_ADDEDGE:
+    case CMD_REMOVEEDGE:
+        if (!(in >> op.a.x >> c1 >> op.a.y >> op.b.x >> c2 >> op.b.y) || c1 != ',' || c2 != ',')
+            return "Invalid edge format\n";
+        return nullptr;
+    case CMD_CH:
+        return nullptr;
+    case CMD_NEWGRAPH:
+        return "Newgraph is not allowed in a transaction\n";
+    case CMD_BEGIN:
+        return "Transaction already in progress\n";
+    default:
+        return "Unknown command\n";
+    }
+}
 
-        double a = gLastArea;
-        bool nowAtLeast100 = (a >= 100.0);
+// Begin: the lines up to Commit are parsed first, then applied under one
+// acquisition of the graph's lock and as one Graph batch, so neither another
+// client, nor the lock-free CH, nor the watches and hull feed see the block
+// half done.
+// Each line gets its usual reply, all sent together and followed by
+// "Committed". If any line doesn't parse, nothing is applied: that line
+// gets its error, the others "Not applied", and the block ends "Aborted".
+// A block longer than MAX_TXN_OPS is aborted as soon as it gets there and
+// the connection closed: the rest of it can be neither kept nor run alone.
+static bool onBegin(Session& s, std::string_view) {
+    std::vector<TxnOp> ops;
+    bool valid = true;
+    std::string_view line;
+    for (;;) {
+        if (!s.reader.hasLine()) s.replies.flush();
+        if (!s.reader.readLine(line)) return false;   // gone mid-block: nothing applied
+        if (line.empty()) continue;
+        std::string_view args;
+        Command cmd = lookupCommand(splitCommand(line, args));
+        if (cmd == CMD_COMMIT) break;
+        if (ops.size() == MAX_TXN_OPS) {
+            s.replies.add("Transaction too large\nAborted\n");
+            return false;
+        }
+        TxnOp op{cmd, Point{0, 0}, Point{0, 0}, nullptr, false, 0};
+        op.error = parseTxnOp(op, args);
+        if (op.error) valid = false;
+        ops.push_back(op);
+    }
+
+    ReplyWriter out(s.replies.buffer());
+    if (!valid) {
+        for (const TxnOp& op : ops) out << (op.error ? op.error : "Not applied\n");
+        out << "Aborted\n";
+        return true;
+    }
 
-        if (nowAtLeast100 && !gAtLeast100) {
-            std::cout << "At Least 100 units belongs to CH\n";
-            gAtLeast100 = true;
-        } else if (!nowAtLeast100 && gAtLeast100) {
-            std::cout << "At Least 100 units no longer belongs to CH\n";
-            gAtLeast100 = false;
+    {
+        std::lock_guard<std::mutex> lock(s.g->mtx);
+        Graph& graph = s.g->graph;
+        graph.beginBatch();               // watchers see the block whole or not at all
+        for (TxnOp& op : ops) {
+            switch (op.cmd) {
+            case CMD_NEWPOINT:    op.ok = graph.addPoint(op.a); break;
+            case CMD_REMOVEPOINT: op.ok = graph.removePoint(op.a); break;
+            case CMD_ADDEDGE:     op.ok = graph.addEdge(op.a, op.b); break;
+            case CMD_REMOVEEDGE:  op.ok = graph.removeEdge(op.a, op.b); break;
+            case CMD_CH:          op.area = graph.area(); break;
+            default: break;
+            }
         }
+        graph.endBatch();
+    }
 
-        gHasUpdated = false; // consume update
+    for (const TxnOp& op : ops) {
+        switch (op.cmd) {
+        case CMD_NEWPOINT:
+            if (op.ok) out << "Point added: " << op.a.x << "," << op.a.y << "\n";
+            else out << "Failed to add point (duplicate)\n";
+            break;
+        case CMD_REMOVEPOINT:
+            if (op.ok) out << "Point removed: " << op.a.x << "," << op.a.y << "\n";
+            else out << "Failed to remove point (not found)\n";
+            break;
+        case CMD_ADDEDGE:
+            if (op.ok) out << "Edge added: (" << op.a.x << "," << op.a.y << ") - (" << op.b.x << "," << op.b.y << ")\n";
+            else out << "Failed to add edge (duplicate)\n";
+            break;
+        case CMD_REMOVEEDGE:
+            if (op.ok) out << "Edge removed: (" << op.a.x << "," << op.a.y << ") - (" << op.b.x << "," << op.b.y << ")\n";
+            else out << "Failed to remove edge (not found)\n";
+            break;
+        case CMD_CH:
+            out << "Area = " << op.area << "\n";
+            break;
+        default:
+            break;
+        }
     }
-    pthread_mutex_unlock(&gMonMtx);
-    return nullptr;
+    out << "Committed\n";
+    return true;
 }
 
+static bool onCommit(Session& s, std::string_view) {
+    s.replies.add("No transaction in progress\n");
+    return true;
+}
 
-static void* handleClient(int clientSocket) {
-    std::string line;
+// Use <name>: later commands on this connection work on that graph,
+// created empty if nobody used it before. The name is one word of at most
+// MAX_NAME bytes; once MAX_GRAPHS exist, only those can be used.
+static bool onUse(Session& s, std::string_view args) {
+    std::string_view rest, extra;
+    std::string_view name = splitCommand(args, rest);
+    if (name.empty() || name.size() > GraphRegistry::MAX_NAME || !splitCommand(rest, extra).empty()) {
+        s.replies.add("Invalid use format\n");
+        return true;
+    }
+    Tenant* t = gGraphs.get(name);
+    if (!t) {
+        s.replies.add("Too many graphs\n");
+        return true;
+    }
+    s.g = t;
+    ReplyWriter(s.replies.buffer()) << "Using graph " << name << "\n";
+    return true;
+}
 
-    while (recvLine(clientSocket, line)) {
-        if (line.empty()) continue;
-        std::istringstream in(line);
-        std::string cmd;
-        in >> cmd;
-
-        if (cmd == "Newgraph") {
-            int n; in >> n;
-            std::vector<Point> pts;
-            bool readOk = true;
-
-            for (int i = 0; i < n; ++i) {
-                if (!recvLine(clientSocket, line)){
-                    readOk = false;
-                    break;
-                } 
-                if (line.empty()) { i--; continue; }
-                double x, y; char comma;
-                std::istringstream ptin(line);
-                if (!(ptin >> x >> comma >> y) || comma != ',') {
-                    std::ostringstream err;
-                    err << "Invalid point format: " << line << "\n";
-                    readOk = false;
-                    sendAll(clientSocket, err.str());
-                    break;
-                }
-                pts.emplace_back(Point{x,y});
-            }
-            if(readOk){
-                std::lock_guard<std::mutex> lock(graphMutex);
-                graph.newGraph(pts);
-                sendAll(clientSocket, "New graph created\n");
-            }
-            continue;
+static void noteWatching(Session& s) {
+    if (std::find(s.watching.begin(), s.watching.end(), s.g) == s.watching.end()) s.watching.push_back(s.g);
+}
 
-        } else if (cmd == "CH") {
-            double area;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                area = graph.area();
-            }
-            std::ostringstream out;
-            out << "Area = " << area << std::endl;
-            pthread_mutex_lock(&gMonMtx);
-            gLastArea = area;
-            gHasUpdated = true;
-            pthread_cond_signal(&gMonCv);
-            pthread_mutex_unlock(&gMonMtx);
-            sendAll(clientSocket, out.str());
-
-        } else if (cmd == "Newpoint") {
-            double x, y; char comma;
-            in >> x >> comma >> y;
-            if (comma != ',') {
-                sendAll(clientSocket, "Invalid point format\n");
-                continue;
-            }
+// Watch <level> [hysteresis]: area crossings of level on the graph in use
+// are pushed to this connection as Event lines until Unwatch <id> or
+// disconnect
+static bool onWatch(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double level, hysteresis = 0;
+    if (!(in >> level) || !std::isfinite(level) ||
+        (!(in >> hysteresis) && !in.eof()) || !std::isfinite(hysteresis) || hysteresis < 0) {
+        s.replies.add("Invalid watch format\n");
+        return true;
+    }
+    bool above;
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(s.g->mtx);
+        AreaMonitor* monitor = s.g->monitor();
+        if (!monitor) {
+            s.replies.add("Cannot watch this graph\n");
+            return true;
+        }
+        id = monitor->watch(&s.replies, level, hysteresis, above);
+    }
+    noteWatching(s);
+    ReplyWriter(s.replies.buffer()) << "Watch " << id << " set at " << level
+                                    << (above ? ": area is above\n" : ": area is below\n");
+    return true;
+}
 
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.addPoint(Point{x, y})) {
-                    sendAll(clientSocket, "Failed to add point (duplicate)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Point added: " << x << "," << y << "\n";
-            sendAll(clientSocket, response.str());
-
-        } else if (cmd == "Removepoint") {
-            double x, y; char comma;
-            in >> x >> comma >> y;
-            if (comma != ',') {
-                sendAll(clientSocket, "Invalid point format\n");
-                continue;
-            }
+static bool onUnwatch(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    int id;
+    bool ok = false;
+    if (in >> id) {
+        std::lock_guard<std::mutex> lock(s.g->mtx);
+        AreaMonitor* monitor = s.g->monitorIfStarted();
+        ok = monitor && monitor->unwatch(&s.replies, id);
+    }
+    if (!ok) {
+        s.replies.add("No such watch\n");
+        return true;
+    }
+    ReplyWriter(s.replies.buffer()) << "Watch " << id << " removed\n";
+    return true;
+}
 
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.removePoint(Point{x, y})) {
-                    sendAll(clientSocket, "Failed to remove point (not found)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Point removed: " << x << "," << y << "\n";
-            sendAll(clientSocket, response.str());
-            
-
-        } else if (cmd == "Addedge") {
-            double x1, y1, x2, y2; char comma1, comma2;
-            in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.addEdge(Point{x1, y1}, Point{x2, y2})) {
-                    sendAll(clientSocket, "Failed to add edge (duplicate)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Edge added: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
-            sendAll(clientSocket, response.str());
+// Subscribe: hull changes of the graph in use are pushed to this connection
+// as Event hull lines (see HullFeed) until Unsubscribe or disconnect
+static bool onSubscribe(Session& s, std::string_view) {
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(s.g->mtx);
+        HullFeed* feed = s.g->feed();
+        if (!feed) {
+            s.replies.add("Cannot subscribe to this graph\n");
+            return true;
+        }
+        const Graph& graph = s.g->graph;
+        ok = feed->subscribe(&s.replies, graph.version(), graph.area(), graph.convexHull());
+    }
+    noteWatching(s);
+    s.replies.add(ok ? "Subscribed\n" : "Already subscribed\n");
+    return true;
+}
+
+static bool onUnsubscribe(Session& s, std::string_view) {
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(s.g->mtx);
+        HullFeed* feed = s.g->feedIfStarted();
+        ok = feed && feed->unsubscribe(&s.replies);
+    }
+    s.replies.add(ok ? "Unsubscribed\n" : "Not subscribed\n");
+    return true;
+}
 
-        } else if (cmd == "Removeedge") {
-            double x1, y1, x2, y2; char comma1, comma2;
-            in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+static bool onUnknown(Session& s, std::string_view) {
+    s.replies.add("Unknown command\n");
+    return false;
+}
+
+static constexpr CommandDispatch<CommandHandler> COMMANDS{onUnknown, {
+    {CMD_NEWGRAPH, onNewgraph},
+    {CMD_CH, onCH},
+    {CMD_NEWPOINT, onNewpoint},
+    {CMD_REMOVEPOINT, onRemovepoint},
+    {CMD_ADDEDGE, onAddedge},
+    {CMD_REMOVEEDGE, onRemoveedge},
+    {CMD_BEGIN, onBegin},
+    {CMD_COMMIT, onCommit},
+    {CMD_WATCH, onWatch},
+    {CMD_UNWATCH, onUnwatch},
+    {CMD_SUBSCRIBE, onSubscribe},
+    {CMD_UNSUBSCRIBE, onUnsubscribe},
+    {CMD_USE, onUse},
+}};
+
+static void* handleClient(int clientSocket) {
+    LineReader reader(clientSocket);
+    ReplyBatch replies(clientSocket);
+    Session s{clientSocket, reader, replies, gDefault, {}};
+    std::string_view line;
+
+    // replies are coalesced per batch, so Nagle would only add delay
+    int one = 1;
+    setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    for (;;) {
+        // about to block for input: whatever this batch produced goes out now
+        if (!reader.hasLine() && !replies.flush()) break;
+        if (!reader.readLine(line)) break;
+        if (line.empty()) continue;
+        std::string_view args;
+        std::string_view cmd = splitCommand(line, args);
+        if (!COMMANDS.find(cmd)(s, args)) break;
+    }
+    for (Tenant* t : s.watching) {
+        std::lock_guard<std::mutex> lock(t->mtx);
+        if (AreaMonitor* monitor = t->monitorIfStarted()) monitor->dropSubscriber(&replies);
+        if (HullFeed* feed = t->feedIfStarted()) feed->unsubscribe(&replies);
+    }
+    replies.flush();
+    close(clientSocket);
+    return nullptr;
+}
+
+// SIGHUP: every graph as Use + Newgraph, so the file can be replayed through
+// a client; written to a temp file first so a crash never leaves half a
+// snapshot. Each graph is copied under its own lock, one at a time.
+static bool writeSnapshot(const char* path) {
+    std::string tmp = std::string(path) + ".tmp";
+    {
+        std::ofstream out(tmp.c_str());
+        if (!out) return false;
+        std::vector<Point> pts;
+        for (Tenant* t : gGraphs.all()) {
             {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.removeEdge(Point{x1, y1}, Point{x2, y2})) {
-                    sendAll(clientSocket, "Failed to remove edge (not found)\n");
-                    continue;
-                }
+                std::lock_guard<std::mutex> lock(t->mtx);
+                pts = t->graph.getPoints();
             }
-            std::ostringstream response;
-            response << "Edge removed: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
-            sendAll(clientSocket, response.str());
+            out << "Use " << t->name << "\n";
+            out << "Newgraph " << pts.size() << "\n";
+            for (size_t i = 0; i < pts.size(); ++i) out << pts[i].x << "," << pts[i].y << "\n";
+        }
+        out << "Use " << DEFAULT_GRAPH << "\n";
+        if (!out.flush()) return false;
+    }
+    return std::rename(tmp.c_str(), path) == 0;
+}
 
-        } else {
-            sendAll(clientSocket, "Unknown command\n");
-            break;
+// main thread parks here; HUP snapshots, anything else means stop
+static void waitForStop(int sigfd) {
+    for (;;) {
+        pollfd p{sigfd, POLLIN, 0};
+        poll(&p, 1, -1);
+        int sig;
+        while ((sig = readSignal(sigfd)) > 0) {
+            if (sig != SIGHUP) return;
+            if (writeSnapshot(SNAPSHOT_PATH)) logPrintf(LOG_LEVEL_INFO, "Snapshot written to %s", SNAPSHOT_PATH);
+            else logPrintf(LOG_LEVEL_ERROR, "Error writing snapshot");
         }
+        if (sig < 0) return;
     }
-    close(clientSocket);
-    return nullptr;
+}
+
+// Unix socket for clients on this host: same protocol, no TCP stack.
+// A socket file left over from a previous run is replaced.
+static int listenUnix(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
 }
 
 int main() {
 
     signal(SIGPIPE, SIG_IGN);
-    struct sigaction sa;
-    sa.sa_handler = on_stop;
-    sigaction(SIGINT, &sa, nullptr);
-    sigaction(SIGTERM, &sa, nullptr);
+    // before any thread exists, so none of them ever takes these signals
+    const int sigs[] = {SIGINT, SIGTERM, SIGHUP};
+    int sigfd = openSignalFd(sigs, 3);
+    if (sigfd < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error creating signalfd");
+        return 1;
+    }
+    // after the signal mask is set, so the flusher thread inherits it; atexit
+    // writes out whatever is still queued on every way out of main
+    if (startLogger(LOG_LEVEL_INFO) == 0) atexit(stopLogger);
 
-    std::cout << "Starting Graph server on port " << PORT << "...\n";
+    logPrintf(LOG_LEVEL_INFO, "Starting Graph server on port %d...", PORT);
 
     int listenfd = socket(AF_INET, SOCK_STREAM, 0);
     if (listenfd < 0) {
-        std::cerr << "Error creating socket\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error creating socket");
         return 1;  
     }
     sockaddr_in serverAddr;
@@ -237,42 +515,65 @@ int main() {
     setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
 
     if (bind(listenfd, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        std::cerr << "Error binding socket\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error binding socket");
         close(listenfd);
         return 1;
     }
 
     if (listen(listenfd, SOMAXCONN) < 0) {
-        std::cerr << "Error listening on socket\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error listening on socket");
         close(listenfd);
         return 1;
     }
 
-    pthread_t monTid;
-    pthread_create(&monTid, nullptr, &monitorArea, nullptr);
-
-    pthread_t acceptTid = startProactor(listenfd, &handleClient);
-    if (!acceptTid) {
-        std::cerr << "Error starting proactor thread\n";
+    int unixfd = listenUnix(UNIX_PATH);
+    if (unixfd < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error listening on %s", UNIX_PATH);
         close(listenfd);
         return 1;
     }
 
-    while(!gStopFlag) {
-        pause();
+    gDefault = gGraphs.get(DEFAULT_GRAPH);
+    {
+        std::lock_guard<std::mutex> lock(gDefault->mtx);
+        AreaMonitor* monitor = gDefault->monitor();
+        if (!monitor) {
+            logPrintf(LOG_LEVEL_ERROR, "Error starting area monitor");
+            close(listenfd);
+            close(unixfd);
+            return 1;
+        }
+        bool above;
+        monitor->watch(nullptr, AREA_LOG_LEVEL, 0, above);
+    }
+
+    admissionConfig adm;
+    adm.max_conns = MAX_CONNS;
+    adm.rate_per_sec = CONN_RATE_PER_SOURCE;
+    adm.burst = CONN_BURST_PER_SOURCE;
+    // each listener has its own accept thread and admission budget
+    pthread_t acceptTid = startProactorLimited(listenfd, &handleClient, &adm);
+    pthread_t unixAcceptTid = acceptTid ? startProactorLimited(unixfd, &handleClient, &adm) : pthread_t{};
+    if (!acceptTid || !unixAcceptTid) {
+        logPrintf(LOG_LEVEL_ERROR, "Error starting proactor thread");
+        if (acceptTid) stopProactor(acceptTid);
+        close(listenfd);
+        close(unixfd);
+        return 1;
     }
 
-    pthread_mutex_lock(&gMonMtx);
-    gShuttingDown = true;
-    pthread_cond_signal(&gMonCv);
-    pthread_mutex_unlock(&gMonMtx);
+    waitForStop(sigfd);
 
-    std::cout << "Shutting down proactor...\n";
+    logPrintf(LOG_LEVEL_INFO, "Shutting down proactor...");
     stopProactor(acceptTid);
-    std::cout << "Proactor stopped\n";
+    stopProactor(unixAcceptTid);
+    logPrintf(LOG_LEVEL_INFO, "Proactor stopped");
 
-    pthread_join(monTid, nullptr);
+    for (Tenant* t : gGraphs.all()) t->stopWatchers();
     close(listenfd);
+    close(unixfd);
+    unlink(UNIX_PATH);
+    close(sigfd);
     return 0;
 
 }
\ No newline at end of file
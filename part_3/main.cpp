@@ -3,74 +3,106 @@
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <string_view>
 #include "Graph.hpp"
+#include "CommandTable.hpp"
+#include "ReplyWriter.hpp"
 
 using namespace std;
 
 
-int main() {
-    ios::sync_with_stdio(false);
-    cin.tie(nullptr);
+// one per command; false stops reading input. args is what follows the name.
+typedef bool (*CommandHandler)(Graph& graph, string_view line, string_view args);
 
-    Graph graph;
+static bool onNewgraph(Graph& graph, string_view, string_view args) {
+    istringstream in{string(args)};
+    int n; in >> n;
+    vector<Point> pts;
     string line;
 
-    while (getline(cin, line)) {
-        if (line.empty()) continue;
-        istringstream in(line);
-        string cmd;
-        in >> cmd;
+    for (int i = 0; i < n; ++i) {
+        if (!getline(cin, line)) break;
+        if (line.empty()) { i--; continue; }
+        double x, y; char comma;
+        istringstream ptin(line);
+        if (!(ptin >> x >> comma >> y) || comma != ',') {
+            cerr << "Invalid point format: " << line << "\n";
+            break;
+        }
+        pts.emplace_back(Point{x,y});
+    }
+    graph.newGraph(pts);
+    return true;
+}
+
+// the whole reply is built first and written with one flush, not one per vertex
+static bool onCH(Graph& graph, string_view, string_view) {
+    static string out;   // reused, so a big hull only allocates the first time
+    out.clear();
+    ReplyWriter w(out);
+    auto hull = graph.convexHull();
+    double area = graph.area();
+    for (auto &p : hull)
+        w << p.x << ',' << p.y << '\n';
+    w << "Area = " << area << '\n';
+    cout.write(out.data(), out.size()).flush();
+    return true;
+}
+
+static bool onNewpoint(Graph& graph, string_view line, string_view args) {
+    istringstream in{string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        cerr << "Invalid point format: " << line << "\n";
+        return true;
+    }
+    if (!graph.addPoint(Point{x, y})) {
+        cerr << "Failed to add point (duplicate)\n";
+    }
+    return true;
+}
 
-        if (cmd == "Newgraph") {
-            int n; in >> n;
-            vector<Point> pts;
+static bool onRemovepoint(Graph& graph, string_view line, string_view args) {
+    istringstream in{string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        cerr << "Invalid point format: " << line << "\n";
+        return true;
+    }
+    if (!graph.removePoint(Point{x, y})) {
+        cerr << "Failed to remove point (not found)\n";
+    }
+    return true;
+}
 
-            for (int i = 0; i < n; ++i) {
-                if (!getline(cin, line)) break;
-                if (line.empty()) { i--; continue; }
-                double x, y; char comma;
-                istringstream ptin(line);
-                if (!(ptin >> x >> comma >> y) || comma != ',') {
-                    cerr << "Invalid point format: " << line << "\n";
-                    break;
-                }
-                pts.emplace_back(Point{x,y});
-            }
-            graph.newGraph(pts);
+static bool onUnknown(Graph&, string_view line, string_view) {
+    string_view args;
+    cerr << "Unknown command: " << splitCommand(line, args) << "\n";
+    return false;
+}
 
-        } else if (cmd == "CH") {
-            auto hull = graph.convexHull();
-            double area = graph.area();
-            for (auto &p : hull)
-                cout << p.x << "," << p.y << std::endl;
-            cout << "Area = " << area << std::endl;
+static constexpr CommandDispatch<CommandHandler> COMMANDS{onUnknown, {
+    {CMD_NEWGRAPH, onNewgraph},
+    {CMD_CH, onCH},
+    {CMD_NEWPOINT, onNewpoint},
+    {CMD_REMOVEPOINT, onRemovepoint},
+}};
 
-        } else if (cmd == "Newpoint") {
-            double x, y; char comma;
-            in >> x >> comma >> y;
-            if (comma != ',') {
-                cerr << "Invalid point format: " << line << "\n";
-                continue;
-            }
-            if (!graph.addPoint(Point{x, y})) {
-                cerr << "Failed to add point (duplicate)\n";
-            }
 
-        } else if (cmd == "Removepoint") {
-            double x, y; char comma;
-            in >> x >> comma >> y;
-            if (comma != ',') {
-                cerr << "Invalid point format: " << line << "\n";
-                continue;
-            }
-            if (!graph.removePoint(Point{x, y})) {
-                cerr << "Failed to remove point (not found)\n";
-            }
+int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
 
-        } else {
-            cerr << "Unknown command: " << cmd << "\n";
-            break;
-        }
+    Graph graph;
+    string line;
+
+    while (getline(cin, line)) {
+        if (line.empty()) continue;
+        string_view args;
+        string_view cmd = splitCommand(line, args);
+        if (!COMMANDS.find(cmd)(graph, line, args)) break;
     }
     return 0;
 }
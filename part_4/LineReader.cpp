@@ -0,0 +1,59 @@
+#include "LineReader.hpp"
+#include <cstring>
+#include <errno.h>
+#include <sys/socket.h>
+
+LineReader::LineReader(int fd, size_t chunk, size_t maxLine)
+    : fd_(fd), chunk_(chunk), maxLine_(maxLine), buf_(chunk) {}
+
+bool LineReader::nextLine(std::string_view& line) {
+    char* nl = static_cast<char*>(memchr(buf_.data() + scanned_, '\n', end_ - scanned_));
+    if (!nl) {
+        scanned_ = end_;
+        return false;
+    }
+    size_t pos = nl - buf_.data();
+    size_t len = pos - start_;
+    if (len > 0 && buf_[pos - 1] == '\r') --len;
+    buf_[start_ + len] = '\0';
+    line = std::string_view(buf_.data() + start_, len);
+    start_ = scanned_ = pos + 1;
+    return true;
+}
+
+bool LineReader::hasLine() {
+    if (memchr(buf_.data() + scanned_, '\n', end_ - scanned_)) return true;
+    scanned_ = end_;
+    return false;
+}
+
+ssize_t LineReader::fill(int flags) {
+    if (scanned_ - start_ >= maxLine_) {          // that much and still no '\n'
+        errno = EMSGSIZE;
+        return -1;
+    }
+    if (start_ == end_) {
+        start_ = scanned_ = end_ = 0;             // everything consumed: rewind
+    } else if (buf_.size() - end_ < chunk_ / 2) {
+        // keep the partial line, make room behind it
+        memmove(buf_.data(), buf_.data() + start_, end_ - start_);
+        end_ -= start_;
+        scanned_ -= start_;
+        start_ = 0;
+        if (buf_.size() - end_ < chunk_ / 2) buf_.resize(buf_.size() * 2);   // one very long line
+    }
+
+    ssize_t n;
+    do {
+        n = recv(fd_, buf_.data() + end_, buf_.size() - end_, flags);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0) end_ += n;
+    return n;
+}
+
+bool LineReader::readLine(std::string_view& line) {
+    while (!nextLine(line)) {
+        if (fill() <= 0) return false;
+    }
+    return true;
+}
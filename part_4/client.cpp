@@ -1,3 +1,4 @@
+#include "LineReader.hpp"
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -21,19 +22,11 @@ bool sendLine(int sock, const std::string& line) {
     return true;
 }
 
-bool recvAndPrint(int sock) {
-    std::string line;
-    line.reserve(256);
-    char c;
-    for(;;) {
-        ssize_t n = recv(sock, &c, 1, 0);
-        if (n < 0) { perror("recv"); return false; }
-        if (n == 0) { std::cout<<"<server closed>\n"; return false; }
-        line.push_back(c);
-        if (c == '\n') break;
-        if (c == '\r') line.push_back(c);
-    }
-    std::cout << line;
+// Print the server's next reply line
+bool recvAndPrint(LineReader& reader) {
+    std::string_view line;
+    if (!reader.readLine(line)) { std::cout<<"<server closed>\n"; return false; }
+    std::cout << line << '\n';
     return true;
 }
 
@@ -50,6 +43,7 @@ int main(){
     }
 
     std::cout<<"Connected. Type commands.\n";
+    LineReader reader(sock);
     std::string line;
     while (std::getline(std::cin,line)){
         if (line.empty()) continue;
@@ -67,7 +61,7 @@ int main(){
         }
 
         // now read the one reply and print it
-        if (!recvAndPrint(sock)) break;
+        if (!recvAndPrint(reader)) break;
     }
 
     close(sock);
@@ -1,9 +1,13 @@
 #include "Graph.hpp"
+#include "LineReader.hpp"
+#include "CommandTable.hpp"
+#include "ReplyWriter.hpp"
 #include <iostream>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <string_view>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
@@ -15,23 +19,13 @@ static constexpr int PORT = 9034;
 static Graph gGraph;
 
 struct ConnState {
-    std::string inbuf;            // bytes accumulated until '\n'
+    LineReader reader;            // buffered input, handed out a line at a time
     int expect_points = 0;        // >0 means NewGraph is waiting for N point lines
     std::vector<Point> pending;   // temp points for NewGraph
-};
 
+    explicit ConnState(int fd = -1) : reader(fd) {}
+};
 
-bool recvLine(int fd, std::string& line) {
-    line.clear();
-    char c;
-    while (true) {
-        ssize_t n = recv(fd, &c, 1, 0);
-        if (n <= 0) return false; // Error or connection closed
-        if (c == '\n') break;
-        if (c != '\r') line.push_back(c);
-    }
-    return true; // Successfully received a line
-}
 
 void sendAll(int fd, const std::string& message) {
     const char* msg = message.data();
@@ -48,18 +42,108 @@ void sendAll(int fd, const std::string& message) {
 }
 
 
-static std::string processLine(ConnState& st, const std::string& rawLine) {
-    std::string line = rawLine;
-    if (!line.empty() && line.back() == '\r') line.pop_back();
+// one per command: the reply, or "" for none yet; args is what follows the name
+typedef std::string (*CommandHandler)(ConnState& st, std::string_view line, std::string_view args);
+
+static std::string onNewgraph(ConnState& st, std::string_view, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    int n; 
+    if (!(in >> n) || n < 0 || (in >> std::ws, !in.eof())) {
+        return "Invalid Newgraph count\n";
+    }
+    st.expect_points = n;
+    st.pending.clear();
+    if (n == 0) {
+        gGraph.newGraph({});
+        st.expect_points = 0;
+        return "New graph created\n";
+    }
+    return ""; // wait for the n point lines
+}
+
+static std::string onCH(ConnState&, std::string_view, std::string_view) {
+    double area = gGraph.area();
+    std::string out;
+    ReplyWriter(out) << "Area = " << area << "\n";
+    return out;
+}
+
+static std::string onNewpoint(ConnState&, std::string_view line, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    if (!(in >> x >> comma >> y) || comma != ',' || (in >> std::ws, !in.eof())) {
+        std::string err; ReplyWriter(err) << "Invalid point format: " << line << "\n";
+        return err;
+    }
+    if (!gGraph.addPoint(Point{x, y})) {
+        return "Failed to add point (duplicate)\n";
+    }
+    return "Point added\n";
+}
+
+static std::string onRemovepoint(ConnState&, std::string_view line, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    if (!(in >> x >> comma >> y) || comma != ',' || (in >> std::ws, !in.eof())) {
+        std::string err; ReplyWriter(err) << "Invalid point format: " << line << "\n";
+        return err;
+    }
+    if (!gGraph.removePoint(Point{x, y})) {
+        return "Failed to remove point (not found)\n";
+    }
+    return "Point removed\n";
+}
+
+static std::string onAddedge(ConnState&, std::string_view line, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char c1, c2;
+    if (!(in >> x1 >> c1 >> y1 >> x2 >> c2 >> y2) || c1 != ',' || c2 != ',' || (in >> std::ws, !in.eof())) {
+        std::string err; ReplyWriter(err) << "Invalid edge format: " << line << "\n";
+        return err;
+    }
+    if (!gGraph.addEdge(Point{x1, y1}, Point{x2, y2})) {
+        return "Failed to add edge\n";
+    }
+    return "Edge added\n";
+}
+
+static std::string onRemoveedge(ConnState&, std::string_view line, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char c1, c2;
+    if (!(in >> x1 >> c1 >> y1 >> x2 >> c2 >> y2) || c1 != ',' || c2 != ',' || (in >> std::ws, !in.eof())) {
+        std::string err; ReplyWriter(err) << "Invalid edge format: " << line << "\n";
+        return err;
+    }
+    if (!gGraph.removeEdge(Point{x1, y1}, Point{x2, y2})) {
+        return "Failed to remove edge\n";
+    }
+    return "Edge removed\n";
+}
+
+static std::string onUnknown(ConnState&, std::string_view, std::string_view) {
+    return "Unknown command\n";
+}
+
+static constexpr CommandDispatch<CommandHandler> COMMANDS{onUnknown, {
+    {CMD_NEWGRAPH, onNewgraph},
+    {CMD_CH, onCH},
+    {CMD_NEWPOINT, onNewpoint},
+    {CMD_REMOVEPOINT, onRemovepoint},
+    {CMD_ADDEDGE, onAddedge},
+    {CMD_REMOVEEDGE, onRemoveedge},
+}};
+
 
+// line comes from the reader, already without '\n' / '\r'
+static std::string processLine(ConnState& st, std::string_view line) {
     // If we're in the middle of NewGraph, treat the line as a point.
     if (st.expect_points > 0) {
         double x, y; char comma;
-        std::istringstream ptin(line);
+        std::istringstream ptin{std::string(line)};
         if (!(ptin >> x >> comma >> y) || comma != ',' || (ptin >> std::ws, !ptin.eof())) {
-            std::ostringstream err; err << "Invalid point format: " << line << "\n";
+            std::string err; ReplyWriter(err) << "Invalid point format: " << line << "\n";
             st.expect_points = 0; st.pending.clear();
-            return err.str();
+            return err;
         }
         st.pending.push_back(Point{x, y});
         if (--st.expect_points == 0) {
@@ -73,75 +157,9 @@ static std::string processLine(ConnState& st, const std::string& rawLine) {
     // Otherwise parse a command line
     if (line.empty()) return "";
 
-    std::istringstream in(line);
-    std::string cmd; in >> cmd;
-
-    if (cmd == "Newgraph") {
-        int n; 
-        if (!(in >> n) || n < 0 || (in >> std::ws, !in.eof())) {
-            return "Invalid Newgraph count\n";
-        }
-        st.expect_points = n;
-        st.pending.clear();
-        if (n == 0) {
-            gGraph.newGraph({});
-            st.expect_points = 0;
-            return "New graph created\n";
-        }
-        return ""; // wait for the n point lines
-
-    } else if (cmd == "CH") {
-        double area = gGraph.area();
-        std::ostringstream out;
-        out << "Area = " << area << "\n";
-        return out.str();
-
-    } else if (cmd == "Newpoint") {
-        double x, y; char comma;
-        if (!(in >> x >> comma >> y) || comma != ',' || (in >> std::ws, !in.eof())) {
-            std::ostringstream err; err << "Invalid point format: " << line << "\n";
-            return err.str();
-        }
-        if (!gGraph.addPoint(Point{x, y})) {
-            return "Failed to add point (duplicate)\n";
-        }
-        return "Point added\n";
-
-    } else if (cmd == "Removepoint") {
-        double x, y; char comma;
-        if (!(in >> x >> comma >> y) || comma != ',' || (in >> std::ws, !in.eof())) {
-            std::ostringstream err; err << "Invalid point format: " << line << "\n";
-            return err.str();
-        }
-        if (!gGraph.removePoint(Point{x, y})) {
-            return "Failed to remove point (not found)\n";
-        }
-        return "Point removed\n";
-
-    } else if (cmd == "Addedge") {
-        double x1, y1, x2, y2; char c1, c2;
-        if (!(in >> x1 >> c1 >> y1 >> x2 >> c2 >> y2) || c1 != ',' || c2 != ',' || (in >> std::ws, !in.eof())) {
-            std::ostringstream err; err << "Invalid edge format: " << line << "\n";
-            return err.str();
-        }
-        if (!gGraph.addEdge(Point{x1, y1}, Point{x2, y2})) {
-            return "Failed to add edge\n";
-        }
-        return "Edge added\n";
-
-    } else if (cmd == "Removeedge") {
-        double x1, y1, x2, y2; char c1, c2;
-        if (!(in >> x1 >> c1 >> y1 >> x2 >> c2 >> y2) || c1 != ',' || c2 != ',' || (in >> std::ws, !in.eof())) {
-            std::ostringstream err; err << "Invalid edge format: " << line << "\n";
-            return err.str();
-        }
-        if (!gGraph.removeEdge(Point{x1, y1}, Point{x2, y2})) {
-            return "Failed to remove edge\n";
-        }
-        return "Edge removed\n";
-    }
-
-    return "Unknown command\n";
+    std::string_view args;
+    std::string_view cmd = splitCommand(line, args);
+    return COMMANDS.find(cmd)(st, line, args);
 }
 
 
@@ -192,11 +210,11 @@ int main() {
                 if (cfd < 0) { perror("accept"); continue; }
                 FD_SET(cfd, &master);
                 if (cfd > fdmax) fdmax = cfd;
-                conns.emplace(cfd, ConnState{});
+                conns.emplace(cfd, ConnState(cfd));
                 std::cout << "Client connected\n";
             } else {
-                char buf[4096];
-                ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                ConnState& st = conns[fd];
+                ssize_t n = st.reader.fill();
                 if (n <= 0) {
                     // client closed or error
                     close(fd);
@@ -206,30 +224,24 @@ int main() {
                     continue;
                 }
 
-                ConnState& st = conns[fd];
-                st.inbuf.append(buf, n);
-
                 // Process all complete lines
-                for (;;) {
-                    auto pos = st.inbuf.find('\n');
-                    if (pos == std::string::npos) break;
-
-                    std::string line = st.inbuf.substr(0, pos + 1);
-                    st.inbuf.erase(0, pos + 1);
-
+                std::string_view line;
+                bool gone = false;
+                while (!gone && st.reader.nextLine(line)) {
                     std::string reply = processLine(st, line);
                     if (!reply.empty()) {
                         const char* p = reply.data(); size_t left = reply.size();
                         while (left) {
                             ssize_t w = send(fd, p, left, 0);
                             if (w <= 0) { // client vanished
-                                close(fd); FD_CLR(fd, &master); conns.erase(fd);
+                                gone = true;
                                 break;
                             }
                             p += w; left -= w;
                         }
                     }
                 }
+                if (gone) { close(fd); FD_CLR(fd, &master); conns.erase(fd); }
             }
         }
     }
@@ -0,0 +1,40 @@
+#include "InputBuffer.hpp"
+#include <cstring>
+
+char* InputBuffer::prepare(size_t min, size_t& avail) {
+    if (start_ == end_) {
+        start_ = scanned_ = end_ = 0;             // everything consumed: rewind for free
+    }
+    if (buf_.size() - end_ < min) {
+        size_t live = end_ - start_;
+        if (start_ > 0) {                         // keep the partial tail, drop the rest
+            memmove(buf_.data(), buf_.data() + start_, live);
+            moved_ += live;
+            scanned_ -= start_;
+            start_ = 0;
+            end_ = live;
+        }
+        if (buf_.size() - end_ < min) {
+            size_t cap = buf_.size() ? buf_.size() * 2 : min;
+            while (cap - end_ < min) cap *= 2;
+            buf_.resize(cap);
+        }
+    }
+    avail = buf_.size() - end_;
+    return buf_.data() + end_;
+}
+
+bool InputBuffer::nextLine(std::string_view& line) {
+    char* nl = static_cast<char*>(memchr(buf_.data() + scanned_, '\n', end_ - scanned_));
+    if (!nl) {
+        scanned_ = end_;
+        return false;
+    }
+    size_t pos = nl - buf_.data();
+    size_t len = pos - start_;
+    if (len > 0 && buf_[pos - 1] == '\r') --len;
+    buf_[start_ + len] = '\0';
+    line = std::string_view(buf_.data() + start_, len);
+    start_ = scanned_ = pos + 1;
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <stddef.h>
+
+
+// Per-connection input buffer that is parsed in place. Received bytes are
+// appended behind the unconsumed ones and handed out as views; consuming
+// just moves an offset. The only copy is moving a trailing partial line
+// (or frame) to the front when the space behind it runs out, so a batch
+// of lines costs no memmove at all.
+class InputBuffer {
+public:
+    // Room for at least `min` more bytes; `avail` gets the actual room.
+    // Invalidates views handed out before.
+    char* prepare(size_t min, size_t& avail);
+    void commit(size_t n) { end_ += n; }
+
+    // Next complete line, without '\n' / trailing '\r' and NUL-terminated
+    // in place; false if no whole line is buffered.
+    bool nextLine(std::string_view& line);
+
+    // Raw access for framed input
+    std::string_view data() const { return std::string_view(buf_.data() + start_, end_ - start_); }
+    void consume(size_t n) { start_ += n; if (scanned_ < start_) scanned_ = start_; }
+    bool empty() const { return start_ == end_; }
+
+    // bytes moved by compaction so far
+    size_t bytesMoved() const { return moved_; }
+
+private:
+    std::vector<char> buf_;
+    size_t start_ = 0;      // first unconsumed byte
+    size_t scanned_ = 0;    // [start_, scanned_) holds no '\n'
+    size_t end_ = 0;        // one past the last byte received
+    size_t moved_ = 0;
+};
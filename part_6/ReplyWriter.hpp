@@ -0,0 +1,41 @@
+#pragma once
+// Appends reply text to a string the caller owns and keeps, so a
+// connection that reuses one buffer stops allocating once it has grown.
+// Doubles are written with std::to_chars: the shortest text that parses
+// back to the same double (Ryu in libstdc++), with no locale, no stream
+// state and nothing flushed.
+//
+//     ReplyWriter(buf) << "Area = " << area << '\n';
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+class ReplyWriter {
+public:
+    explicit ReplyWriter(std::string& buf) : buf_(buf) {}
+
+    ReplyWriter& operator<<(std::string_view s) { buf_.append(s.data(), s.size()); return *this; }
+    ReplyWriter& operator<<(char c) { buf_.push_back(c); return *this; }
+
+    ReplyWriter& operator<<(double d) {
+        char tmp[32];   // longest shortest form is 24 chars ("-2.2250738585072014e-308")
+        std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), d);
+        buf_.append(tmp, r.ptr - tmp);
+        return *this;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value &&
+                                !std::is_same<T, bool>::value, ReplyWriter&>::type
+    operator<<(T v) {
+        char tmp[24];
+        std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf_.append(tmp, r.ptr - tmp);
+        return *this;
+    }
+
+private:
+    std::string& buf_;
+};
@@ -0,0 +1,145 @@
+#include "ShmRing.hpp"
+#include <new>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+
+static constexpr int RING_SEALS = F_SEAL_SHRINK | F_SEAL_GROW;
+
+ShmRing::ShmRing(int memfd, int dataFd, int spaceFd, void* base, size_t len, uint64_t cap)
+    : memfd_(memfd), datafd_(dataFd), spacefd_(spaceFd),
+      hdr_(static_cast<Header*>(base)), len_(len), cap_(cap) {}
+
+ShmRing::~ShmRing() {
+    munmap(hdr_, len_);
+    close(memfd_);
+    close(datafd_);
+    close(spacefd_);
+}
+
+ShmRing* ShmRing::create(uint64_t capacity) {
+    uint64_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    size_t len = sizeof(Header) + cap * sizeof(Point);
+
+    int memfd = memfd_create("graph-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd < 0) return NULL;
+    int dataFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int spaceFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    void* base = MAP_FAILED;
+    if (dataFd >= 0 && spaceFd >= 0 && ftruncate(memfd, len) == 0 &&
+        fcntl(memfd, F_ADD_SEALS, RING_SEALS | F_SEAL_SEAL) == 0) {
+        base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    }
+    if (base == MAP_FAILED) {
+        close(memfd);
+        if (dataFd >= 0) close(dataFd);
+        if (spaceFd >= 0) close(spaceFd);
+        return NULL;
+    }
+
+    Header* h = new (base) Header();
+    h->head.store(0);
+    h->tail.store(0);
+    h->capacity = cap;
+    return new ShmRing(memfd, dataFd, spaceFd, base, len, cap);
+}
+
+// an anonymous-inode fd (eventfd and kin, no pipe, socket or file), made
+// nonblocking so a read or write on it can never hold up the caller
+static bool eventFdLike(int fd) {
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (sb.st_mode & S_IFMT) != 0) return false;
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+ShmRing* ShmRing::attach(int memfd, int dataFd, int spaceFd) {
+    struct stat sb;
+    void* base = MAP_FAILED;
+    size_t len = 0;
+    uint64_t cap = 0;
+    // sealed first, sized after: the size can't change once the seals hold
+    int seals = fcntl(memfd, F_GET_SEALS);
+    if (seals >= 0 && (seals & RING_SEALS) == RING_SEALS &&
+        eventFdLike(dataFd) && eventFdLike(spaceFd) &&
+        fstat(memfd, &sb) == 0 && S_ISREG(sb.st_mode) && (size_t)sb.st_size > sizeof(Header)) {
+        len = (size_t)sb.st_size;
+        base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    }
+    if (base != MAP_FAILED) {
+        // the other side wrote the header; only trust it if it fits the mapping
+        cap = static_cast<Header*>(base)->capacity;
+        if (cap == 0 || (cap & (cap - 1)) != 0 ||
+            cap > (len - sizeof(Header)) / sizeof(Point)) {
+            munmap(base, len);
+            base = MAP_FAILED;
+        }
+    }
+    if (base == MAP_FAILED) {
+        close(memfd);
+        close(dataFd);
+        close(spaceFd);
+        return NULL;
+    }
+    return new ShmRing(memfd, dataFd, spaceFd, base, len, cap);
+}
+
+bool ShmRing::push(const Point* pts, size_t n) {
+    const uint64_t cap = cap_;
+    while (n > 0) {
+        uint64_t head = hdr_->head.load(std::memory_order_relaxed);
+        uint64_t tail = hdr_->tail.load(std::memory_order_acquire);
+        uint64_t room = cap - (head - tail);
+        if (room == 0) {
+            uint64_t v;
+            if (read(spacefd_, &v, sizeof(v)) < 0) {
+                if (errno != EAGAIN && errno != EINTR) return false;
+                pollfd p{spacefd_, POLLIN, 0};
+                if (poll(&p, 1, -1) < 0 && errno != EINTR) return false;
+            }
+            continue;
+        }
+        uint64_t k = n < room ? n : room;
+        uint64_t at = head & (cap - 1);
+        uint64_t first = k < cap - at ? k : cap - at;   // up to the wrap
+        memcpy(slots() + at, pts, first * sizeof(Point));
+        memcpy(slots(), pts + first, (k - first) * sizeof(Point));
+        hdr_->head.store(head + k, std::memory_order_release);
+
+        uint64_t one = 1;
+        // EAGAIN: the counter is far from zero, so the consumer is woken anyway
+        if (write(datafd_, &one, sizeof(one)) < 0 && errno != EAGAIN) return false;
+        pts += k;
+        n -= k;
+    }
+    return true;
+}
+
+size_t ShmRing::pop(std::vector<Point>& out, size_t max) {
+    uint64_t v;
+    (void)!read(datafd_, &v, sizeof(v));   // reset before looking at head
+
+    const uint64_t cap = cap_;
+    uint64_t tail = hdr_->tail.load(std::memory_order_relaxed);
+    uint64_t head = hdr_->head.load(std::memory_order_acquire);
+    uint64_t avail = head - tail;
+    if (avail > cap) avail = cap;          // a confused producer can't make us overrun
+    if (avail > max) avail = max;
+    if (avail == 0) return 0;
+
+    uint64_t at = tail & (cap - 1);
+    uint64_t first = avail < cap - at ? avail : cap - at;
+    out.insert(out.end(), slots() + at, slots() + at + first);
+    out.insert(out.end(), slots(), slots() + (avail - first));
+    hdr_->tail.store(tail + avail, std::memory_order_release);
+
+    uint64_t one = 1;
+    (void)!write(spacefd_, &one, sizeof(one));
+    return avail;
+}
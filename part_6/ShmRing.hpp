@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Point.hpp"
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Single-producer / single-consumer ring of points in a memfd, for bulk
+// uploads from a client on the same host. The client creates it and hands
+// the three fds to the server over the Unix socket (SCM_RIGHTS); after
+// that, points move through shared memory without a syscall per line.
+//
+// Signalling is two eventfds: the producer bumps dataFd() after publishing
+// points, the consumer bumps spaceFd() after freeing slots. Both are
+// nonblocking, so nothing the client does to them can stall the server's
+// reactor; a producer facing a full ring polls spaceFd().
+//
+// The memfd is sealed against shrinking and growing before it is handed
+// over, and attach() refuses one that isn't: a client truncating the file
+// under the server's mapping would otherwise kill it with SIGBUS.
+class ShmRing {
+public:
+    // producer side; capacity is rounded up to a power of two
+    static ShmRing* create(uint64_t capacity);
+
+    // consumer side; takes ownership of the fds, NULL if they don't
+    // describe a valid ring (a sealed memfd and two eventfds)
+    static ShmRing* attach(int memfd, int dataFd, int spaceFd);
+
+    ~ShmRing();
+
+    int memFd() const { return memfd_; }
+    int dataFd() const { return datafd_; }
+    int spaceFd() const { return spacefd_; }
+
+    // producer: blocks while the ring is full
+    bool push(const Point* pts, size_t n);
+
+    // consumer: appends what is available (at most max), never blocks
+    size_t pop(std::vector<Point>& out, size_t max);
+
+private:
+    struct Header {
+        std::atomic<uint64_t> head;   // points published by the producer
+        std::atomic<uint64_t> tail;   // points taken by the consumer
+        uint64_t capacity;
+    };
+
+    ShmRing(int memfd, int dataFd, int spaceFd, void* base, size_t len, uint64_t cap);
+
+    Point* slots() const { return reinterpret_cast<Point*>(hdr_ + 1); }
+
+    int memfd_;
+    int datafd_;
+    int spacefd_;
+    Header* hdr_;
+    size_t len_;
+    uint64_t cap_;   // checked once; the header's copy is the other side's to scribble on
+};
@@ -0,0 +1,125 @@
+#pragma once
+// Binary framing, negotiated per connection: a client whose first byte is
+// WIRE_MAGIC speaks frames from then on, anything else is the text
+// protocol. Both are served on the same port.
+//
+//   frame  := u8 opcode | u32 payload length | payload
+//   point  := f64 x | f64 y
+//   points := u32 count | count * point
+//
+// All integers and doubles are little-endian.
+
+#include "Point.hpp"
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+static constexpr unsigned char WIRE_MAGIC = 0xB7;   // not printable, never starts a text command
+static constexpr size_t WIRE_HEADER = 5;
+static constexpr uint32_t WIRE_MAX_PAYLOAD = 64u << 20;
+static constexpr size_t WIRE_POINT = 16;
+static_assert(sizeof(Point) == WIRE_POINT, "points are copied to and from the wire as-is");
+
+enum WireOp : uint8_t {
+    // requests
+    OP_NEWGRAPH    = 0x01,   // points
+    OP_CH          = 0x02,   // empty -> OP_AREA
+    OP_HULL        = 0x03,   // empty -> OP_POINTS
+    OP_NEWPOINT    = 0x04,   // point
+    OP_REMOVEPOINT = 0x05,   // point
+    OP_ADDEDGE     = 0x06,   // point point
+    OP_REMOVEEDGE  = 0x07,   // point point
+
+    // replies
+    OP_OK          = 0x80,   // empty
+    OP_ERROR       = 0x81,   // message text
+    OP_AREA        = 0x82,   // f64
+    OP_POINTS      = 0x83,   // points
+};
+
+inline void wirePutU32(std::string& out, uint32_t v) {
+    char b[4] = {(char)(v & 0xff), (char)((v >> 8) & 0xff), (char)((v >> 16) & 0xff), (char)(v >> 24)};
+    out.append(b, 4);
+}
+
+inline uint32_t wireGetU32(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+inline void wirePutF64(std::string& out, double d) {
+    uint64_t v;
+    memcpy(&v, &d, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    out.append(reinterpret_cast<const char*>(&v), 8);
+}
+
+inline double wireGetF64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    double d;
+    memcpy(&d, &v, 8);
+    return d;
+}
+
+inline void wirePutPoint(std::string& out, const Point& p) {
+    wirePutF64(out, p.x);
+    wirePutF64(out, p.y);
+}
+
+inline Point wireGetPoint(const char* p) {
+    return Point{wireGetF64(p), wireGetF64(p + 8)};
+}
+
+// Doubles off the wire can be anything; a NaN breaks the ordering the hull
+// sorts by, so requests only take finite coordinates.
+inline bool wireFinite(const Point& pt) {
+    return std::isfinite(pt.x) && std::isfinite(pt.y);
+}
+
+inline void wirePutPoints(std::string& out, const std::vector<Point>& pts) {
+    wirePutU32(out, (uint32_t)pts.size());
+    size_t at = out.size();
+    out.resize(at + pts.size() * WIRE_POINT);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&out[at], pts.data(), pts.size() * WIRE_POINT);   // Point is two packed doubles already
+#else
+    out.resize(at);
+    for (size_t i = 0; i < pts.size(); ++i) wirePutPoint(out, pts[i]);
+#endif
+}
+
+// false if the payload is not exactly a points block, or holds a point
+// that is not finite
+inline bool wireGetPoints(const char* p, size_t len, std::vector<Point>& pts) {
+    if (len < 4) return false;
+    uint32_t n = wireGetU32(p);
+    if ((len - 4) / WIRE_POINT != n || (len - 4) % WIRE_POINT != 0) return false;
+    pts.resize(n);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(pts.data(), p + 4, (size_t)n * WIRE_POINT);
+#else
+    for (uint32_t i = 0; i < n; ++i) pts[i] = wireGetPoint(p + 4 + i * WIRE_POINT);
+#endif
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!wireFinite(pts[i])) return false;
+    }
+    return true;
+}
+
+inline std::string wireFrame(uint8_t op, const std::string& payload) {
+    std::string out;
+    out.reserve(WIRE_HEADER + payload.size());
+    out.push_back((char)op);
+    wirePutU32(out, (uint32_t)payload.size());
+    out += payload;
+    return out;
+}
@@ -0,0 +1,72 @@
+#include "WorkerPool.hpp"
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+WorkerPool::WorkerPool(int nthreads) {
+    donefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    for (int i = 0; i < nthreads; ++i) {
+        threads_.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+    if (donefd_ != -1) close(donefd_);
+}
+
+void WorkerPool::post(void* ctx, uint64_t seq, Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        tasks_.push_back(Task{ctx, seq, std::move(job)});
+    }
+    cv_.notify_one();
+}
+
+std::vector<WorkerPool::Done> WorkerPool::takeCompleted() {
+    uint64_t cnt;
+    (void)!read(donefd_, &cnt, sizeof(cnt));   // reset before taking the batch
+
+    std::vector<Done> out;
+    std::lock_guard<std::mutex> lock(doneMtx_);
+    out.swap(done_);
+    return out;
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        if (threads_[i].joinable()) threads_[i].join();
+    }
+}
+
+void WorkerPool::run() {
+    for (;;) {
+        Task t;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this]{ return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) return;   // stopping and nothing left
+            t = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        std::string reply = t.job();
+
+        bool wasEmpty;
+        {
+            std::lock_guard<std::mutex> lock(doneMtx_);
+            wasEmpty = done_.empty();
+            done_.push_back(Done{t.ctx, t.seq, std::move(reply)});
+        }
+        // one wakeup per batch, same as the reactor's command queue
+        if (wasEmpty) {
+            uint64_t one = 1;
+            (void)!write(donefd_, &one, sizeof(one));
+        }
+    }
+}
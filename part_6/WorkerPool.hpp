@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+
+// Fixed set of threads that run CPU-heavy work off the reactor thread.
+// Each job produces a reply; finished replies wait in a completion queue
+// and completionFd() becomes readable so the reactor can pick them up.
+class WorkerPool {
+public:
+    typedef std::function<std::string()> Job;
+
+    struct Done {
+        void* ctx;          // whatever the poster passed, usually its connection
+        uint64_t seq;       // reply slot within that connection
+        std::string reply;
+    };
+
+    explicit WorkerPool(int nthreads);
+    ~WorkerPool();
+
+    int completionFd() const { return donefd_; }
+
+    void post(void* ctx, uint64_t seq, Job job);
+
+    // Called from the reactor thread when completionFd() is readable.
+    std::vector<Done> takeCompleted();
+
+    void stop();
+
+private:
+    struct Task {
+        void* ctx;
+        uint64_t seq;
+        Job job;
+    };
+
+    void run();
+
+    std::vector<std::thread> threads_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Task> tasks_;
+    bool stopping_ = false;
+
+    std::mutex doneMtx_;
+    std::vector<Done> done_;
+    int donefd_ = -1;
+};
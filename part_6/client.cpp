@@ -1,12 +1,19 @@
+#include "ShmRing.hpp"
+#include "WireProtocol.hpp"
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <cstring>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 
 static constexpr int PORT = 9034;
 static constexpr const char* HOST = "127.0.0.1";
+static constexpr const char* UNIX_PATH = "/tmp/graph_server.sock";
+static constexpr uint64_t RING_POINTS = 1 << 16;   // 1 MiB of points in flight
 
 bool sendLine(int sock, const std::string& line) {
     std::string out = line + "\n";
@@ -37,30 +44,210 @@ bool recvAndPrint(int sock) {
     return true;
 }
 
-int main(){
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0){ perror("socket"); return 1; }
+// "Shmgraph n" with the ring's fds attached, then the points through the
+// ring; prints the reply like the text path does
+bool shmUpload(int sock, int n) {
+    std::vector<Point> pts;
+    pts.reserve(n);
+    std::string line, bad;
+    for (int i = 0; i < n && std::getline(std::cin, line); ++i) {
+        double x, y; char comma;
+        std::istringstream ptin(line);
+        if (!(ptin >> x >> comma >> y) || comma != ',') {
+            if (bad.empty()) bad = line;
+            continue;
+        }
+        pts.push_back(Point{x, y});
+    }
+    if (!bad.empty()) {
+        std::cout << "Invalid point format: " << bad << "\n";
+        return true;   // nothing sent yet, the connection is fine
+    }
+
+    ShmRing* ring = ShmRing::create(n < (int)RING_POINTS ? (n > 0 ? n : 1) : RING_POINTS);
+    if (!ring) { perror("ring"); return false; }
+
+    std::string hdr = "Shmgraph " + std::to_string(pts.size()) + "\n";
+    iovec iov{(void*)hdr.data(), hdr.size()};
+    int fds[3] = {ring->memFd(), ring->dataFd(), ring->spaceFd()};
+    union {
+        cmsghdr align;
+        char space[CMSG_SPACE(sizeof(fds))];
+    } ctl;
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.space;
+    msg.msg_controllen = sizeof(ctl.space);
+    cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+    bool ok = sendmsg(sock, &msg, 0) == (ssize_t)hdr.size() && ring->push(pts.data(), pts.size());
+    if (!ok) perror("upload");
+    delete ring;   // the server holds its own references
+    return ok && recvAndPrint(sock);
+}
+
+bool sendAllBytes(int sock, const std::string& out) {
+    const char* data = out.data();
+    size_t toSend = out.size();
+    while (toSend) {
+        ssize_t n = send(sock, data, toSend, 0);
+        if (n < 0) { perror("send"); return false; }
+        data   += n;
+        toSend -= n;
+    }
+    return true;
+}
 
-    sockaddr_in srv{};
-    srv.sin_family = AF_INET;
-    srv.sin_port   = htons(PORT);
-    inet_pton(AF_INET, HOST, &srv.sin_addr);
-    if (connect(sock,(sockaddr*)&srv,sizeof(srv))<0){
-        perror("connect"); return 1;
+bool recvExact(int sock, char* buf, size_t len) {
+    while (len) {
+        ssize_t n = recv(sock, buf, len, 0);
+        if (n < 0) { perror("recv"); return false; }
+        if (n == 0) { std::cout<<"<server closed>\n"; return false; }
+        buf += n;
+        len -= n;
     }
+    return true;
+}
+
+// one reply frame, printed the way the text protocol would say it
+bool recvAndPrintFrame(int sock) {
+    char hdr[WIRE_HEADER];
+    if (!recvExact(sock, hdr, sizeof(hdr))) return false;
+    std::string payload(wireGetU32(hdr + 1), '\0');
+    if (!recvExact(sock, &payload[0], payload.size())) return false;
+
+    switch ((uint8_t)hdr[0]) {
+    case OP_OK:    std::cout << "OK\n"; break;
+    case OP_ERROR: std::cout << payload << "\n"; break;
+    case OP_AREA:
+        if (payload.size() == 8) std::cout << "Area = " << wireGetF64(payload.data()) << "\n";
+        break;
+    case OP_POINTS: {
+        std::vector<Point> pts;
+        if (!wireGetPoints(payload.data(), payload.size(), pts)) break;
+        std::cout << "Hull (" << pts.size() << " points)\n";
+        for (size_t i = 0; i < pts.size(); ++i) std::cout << pts[i].x << "," << pts[i].y << "\n";
+        break;
+    }
+    default:
+        std::cout << "<unknown reply " << (int)(uint8_t)hdr[0] << ">\n";
+    }
+    return true;
+}
+
+// "x,y" (with optional spaces) -> Point
+static bool parsePoint(std::istream& in, Point& p) {
+    char comma;
+    return (in >> p.x >> comma >> p.y) && comma == ',';
+}
+
+// The typed command as a frame; false (with a message printed) if it
+// has no binary form or doesn't parse. Newgraph reads its points from cin.
+bool encodeCommand(const std::string& cmd, std::istringstream& iss, std::string& frame) {
+    std::string payload;
+    Point a, b;
+    if (cmd == "Newgraph") {
+        int n = -1;
+        iss >> n;
+        std::vector<Point> pts;
+        std::string line, bad;
+        for (int i = 0; i < n && std::getline(std::cin, line); ++i) {
+            std::istringstream ptin(line);
+            if (parsePoint(ptin, a)) pts.push_back(a);
+            else if (bad.empty()) bad = line;
+        }
+        if (n < 0 || !bad.empty()) {
+            std::cout << (n < 0 ? "Invalid Newgraph count" : "Invalid point format: " + bad) << "\n";
+            return false;
+        }
+        wirePutPoints(payload, pts);
+        frame = wireFrame(OP_NEWGRAPH, payload);
+    } else if (cmd == "CH" || cmd == "Hull") {
+        frame = wireFrame(cmd == "CH" ? OP_CH : OP_HULL, payload);
+    } else if (cmd == "Newpoint" || cmd == "Removepoint") {
+        if (!parsePoint(iss, a)) { std::cout << "Invalid point format\n"; return false; }
+        wirePutPoint(payload, a);
+        frame = wireFrame(cmd == "Newpoint" ? OP_NEWPOINT : OP_REMOVEPOINT, payload);
+    } else if (cmd == "Addedge" || cmd == "Removeedge") {
+        if (!parsePoint(iss, a) || !parsePoint(iss, b)) { std::cout << "Invalid edge format\n"; return false; }
+        wirePutPoint(payload, a);
+        wirePutPoint(payload, b);
+        frame = wireFrame(cmd == "Addedge" ? OP_ADDEDGE : OP_REMOVEEDGE, payload);
+    } else {
+        std::cout << "Unknown command\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    // -u: connect over the Unix socket; -s: also send Newgraph points
+    // through a shared-memory ring (needs -u); -b: binary protocol
+    bool useUnix = false, useShm = false, useBinary = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-u")) useUnix = true;
+        else if (!strcmp(argv[i], "-s")) useShm = useUnix = true;
+        else if (!strcmp(argv[i], "-b")) useBinary = true;
+        else { std::cerr << "usage: " << argv[0] << " [-u] [-s] [-b]\n"; return 1; }
+    }
+    if (useShm && useBinary) { std::cerr << "-s and -b don't mix\n"; return 1; }
+
+    int sock;
+    if (useUnix) {
+        sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sock < 0){ perror("socket"); return 1; }
+        sockaddr_un srv{};
+        srv.sun_family = AF_UNIX;
+        strncpy(srv.sun_path, UNIX_PATH, sizeof(srv.sun_path) - 1);
+        if (connect(sock,(sockaddr*)&srv,sizeof(srv))<0){
+            perror("connect"); return 1;
+        }
+    } else {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0){ perror("socket"); return 1; }
+
+        sockaddr_in srv{};
+        srv.sin_family = AF_INET;
+        srv.sin_port   = htons(PORT);
+        inet_pton(AF_INET, HOST, &srv.sin_addr);
+        if (connect(sock,(sockaddr*)&srv,sizeof(srv))<0){
+            perror("connect"); return 1;
+        }
+    }
+
+    if (useBinary && !sendAllBytes(sock, std::string(1, (char)WIRE_MAGIC))) return 1;
 
     std::cout<<"Connected. Type commands.\n";
     std::string line;
     while (std::getline(std::cin,line)){
         if (line.empty()) continue;
+        std::istringstream iss(line);
+        std::string cmd; iss>>cmd;
+
+        if (useBinary) {
+            std::string frame;
+            if (!encodeCommand(cmd, iss, frame)) continue;
+            if (!sendAllBytes(sock, frame) || !recvAndPrintFrame(sock)) break;
+            continue;
+        }
+
+        int n = 0;
+        if (cmd=="Newgraph") iss>>n;
+        if (useShm && cmd=="Newgraph" && n >= 0) {
+            if (!shmUpload(sock, n)) break;
+            continue;
+        }
+
         // send header
         if (!sendLine(sock,line)) break;
 
         // if NewGraph, read & send the next n point‐lines
-        std::istringstream iss(line);
-        std::string cmd; iss>>cmd;
         if (cmd=="Newgraph"){
-            int n; iss>>n;
             for(int i=0;i<n;++i){
                 std::getline(std::cin,line);
                 sendLine(sock,line);
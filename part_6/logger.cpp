@@ -0,0 +1,236 @@
+#include "reactor.hpp"
+#include <new>
+#include <atomic>
+#include <thread>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+// ----- asynchronous logging -----
+// Callers format into a slot of a bounded multi-producer ring (sequence-
+// numbered slots: one CAS to claim a slot, one store to publish it) and
+// return. The flusher thread prefixes each line with its timestamp and
+// level and writes whatever has piled up with one write() per stream. A
+// full ring drops the message rather than make the caller wait.
+
+static const size_t LOG_SLOTS = 4096;        // power of two
+static const size_t LOG_MSG_MAX = 232;       // longer messages are cut
+static const long LOG_IDLE_NS = 1000000;     // flusher nap when the ring is empty
+static const size_t LOG_OUT_MAX = 64 * 1024; // written out when a batch gets this big
+
+struct logSlot {
+    std::atomic<size_t> seq;   // == index: free; == index + 1: published
+    int level;
+    int len;
+    timespec ts;
+    char msg[LOG_MSG_MAX];
+};
+
+struct logger {
+    logSlot slots[LOG_SLOTS];
+    std::atomic<size_t> head;          // next slot a producer claims
+    size_t tail;                       // next slot to flush; flusher only
+    std::atomic<unsigned long> dropped;
+    std::atomic<bool> stop;
+    int minLevel;
+    std::thread flusher;
+
+    logger(int level) : head(0), tail(0), dropped(0), stop(false), minLevel(level) {
+        for (size_t i = 0; i < LOG_SLOTS; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+};
+
+static std::atomic<logger*> gLogger(NULL);
+static std::atomic<int> gWriters(0);       // producers between loading gLogger and publishing
+static std::atomic<int> gSyncLevel(LOG_LEVEL_INFO);   // used while no logger runs
+
+static const char* levelName(int level) {
+    switch (level) {
+    case LOG_LEVEL_DEBUG: return "DEBUG";
+    case LOG_LEVEL_INFO:  return "INFO ";
+    case LOG_LEVEL_WARN:  return "WARN ";
+    default:              return "ERROR";
+    }
+}
+
+static int levelFd(int level) {
+    return level >= LOG_LEVEL_WARN ? STDERR_FILENO : STDOUT_FILENO;
+}
+
+static void writeAllFd(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+// "HH:MM:SS.mmm LEVEL msg\n" appended to out; the wall-clock part is only
+// recomputed when the second changes
+struct lineFormatter {
+    time_t sec;
+    char hms[16];
+
+    lineFormatter() : sec(-1) { hms[0] = '\0'; }
+
+    size_t format(char* out, size_t room, int level, const timespec& ts, const char* msg, int len) {
+        if (ts.tv_sec != sec) {
+            struct tm tmv;
+            localtime_r(&ts.tv_sec, &tmv);
+            strftime(hms, sizeof(hms), "%H:%M:%S", &tmv);
+            sec = ts.tv_sec;
+        }
+        int n = snprintf(out, room, "%s.%03ld %s %.*s\n", hms, ts.tv_nsec / 1000000, levelName(level), len, msg);
+        if (n < 0) return 0;
+        return (size_t)n < room ? (size_t)n : room - 1;
+    }
+};
+
+struct logBatch {
+    int fd;
+    char buf[LOG_OUT_MAX];
+    size_t used;
+
+    explicit logBatch(int f) : fd(f), used(0) {}
+
+    void add(lineFormatter& fmt, int level, const timespec& ts, const char* msg, int len) {
+        if (LOG_OUT_MAX - used < LOG_MSG_MAX + 64) flush();
+        used += fmt.format(buf + used, LOG_OUT_MAX - used, level, ts, msg, len);
+    }
+
+    void flush() {
+        writeAllFd(fd, buf, used);
+        used = 0;
+    }
+};
+
+static void flusherLoop(logger* L) {
+    lineFormatter fmt;
+    logBatch* out = new logBatch(STDOUT_FILENO);
+    logBatch* err = new logBatch(STDERR_FILENO);
+
+    for (;;) {
+        bool stopping = L->stop.load(std::memory_order_acquire);
+        size_t taken = 0;
+        for (;;) {
+            logSlot& s = L->slots[L->tail & (LOG_SLOTS - 1)];
+            if (s.seq.load(std::memory_order_acquire) != L->tail + 1) break;
+            (levelFd(s.level) == STDERR_FILENO ? err : out)->add(fmt, s.level, s.ts, s.msg, s.len);
+            s.seq.store(L->tail + LOG_SLOTS, std::memory_order_release);   // free for the next lap
+            ++L->tail;
+            ++taken;
+        }
+
+        unsigned long lost = L->dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            timespec now;
+            clock_gettime(CLOCK_REALTIME_COARSE, &now);
+            char msg[64];
+            int len = snprintf(msg, sizeof(msg), "%lu log messages dropped", lost);
+            err->add(fmt, LOG_LEVEL_WARN, now, msg, len);
+        }
+        out->flush();
+        err->flush();
+
+        if (taken == 0 && lost == 0) {
+            if (stopping) break;     // stop was seen before this empty pass: nothing can be left
+            timespec nap = {0, LOG_IDLE_NS};
+            nanosleep(&nap, NULL);
+        }
+    }
+    delete out;
+    delete err;
+}
+
+static void logSync(int level, const timespec& ts, const char* msg, int len) {
+    lineFormatter fmt;
+    char line[LOG_MSG_MAX + 64];
+    size_t n = fmt.format(line, sizeof(line), level, ts, msg, len);
+    writeAllFd(levelFd(level), line, n);
+}
+
+int startLogger(logLevel minLevel) {
+    if (gLogger.load()) return -1;
+    logger* L = new (std::nothrow) logger(minLevel);
+    if (!L) return -1;
+    try {
+        L->flusher = std::thread(flusherLoop, L);
+    } catch (...) {
+        delete L;
+        return -1;
+    }
+    gSyncLevel.store(minLevel);
+    gLogger.store(L, std::memory_order_release);
+    return 0;
+}
+
+void logPrintf(logLevel level, const char* fmt, ...) {
+    int saved = errno;   // kept for a %m in fmt
+    gWriters.fetch_add(1);   // stopLogger() waits for us before freeing L
+    logger* L = gLogger.load();
+    if ((int)level < (L ? L->minLevel : gSyncLevel.load(std::memory_order_relaxed))) {
+        gWriters.fetch_sub(1);
+        return;
+    }
+
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);   // vDSO, no syscall
+
+    if (!L) {
+        gWriters.fetch_sub(1);
+        char msg[LOG_MSG_MAX];
+        va_list ap;
+        va_start(ap, fmt);
+        errno = saved;
+        int n = vsnprintf(msg, sizeof(msg), fmt, ap);
+        va_end(ap);
+        if (n < 0) return;
+        logSync(level, ts, msg, n < (int)sizeof(msg) ? n : (int)sizeof(msg) - 1);
+        return;
+    }
+
+    size_t pos = L->head.load(std::memory_order_relaxed);
+    logSlot* s;
+    for (;;) {
+        s = &L->slots[pos & (LOG_SLOTS - 1)];
+        size_t seq = s->seq.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (L->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            L->dropped.fetch_add(1, std::memory_order_relaxed);   // full: the flusher is a lap behind
+            gWriters.fetch_sub(1);
+            return;
+        } else {
+            pos = L->head.load(std::memory_order_relaxed);
+        }
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    errno = saved;
+    int n = vsnprintf(s->msg, sizeof(s->msg), fmt, ap);
+    va_end(ap);
+    s->len = n < 0 ? 0 : (n < (int)sizeof(s->msg) ? n : (int)sizeof(s->msg) - 1);
+    s->level = level;
+    s->ts = ts;
+    s->seq.store(pos + 1, std::memory_order_release);
+    gWriters.fetch_sub(1, std::memory_order_release);
+}
+
+void stopLogger(void) {
+    logger* L = gLogger.exchange(NULL);
+    if (!L) return;
+    while (gWriters.load() > 0) std::this_thread::yield();   // late messages go out synchronously
+    L->stop.store(true, std::memory_order_release);
+    L->flusher.join();
+    delete L;
+}
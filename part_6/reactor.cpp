@@ -1,112 +1,284 @@
 #include "reactor.hpp"
-#include <algorithm>
 #include <new>
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <stdint.h>
 #include <unistd.h>
-#include <sys/select.h>
-#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
 #include <errno.h>
 
-// command sent through the wake pipe
-enum CmdType { CMD_ADD, CMD_RM, CMD_STOP };
+// command queued for the reactor thread
+enum CmdType { CMD_ADD, CMD_RM, CMD_EVENTS };
 
 struct Cmd {
-    CmdType     t;
-    int         fd;
-    reactorFunc cb;
+    CmdType        t;
+    int            fd;
+    reactorFunc    cb;
+    reactorCtxFunc ctxcb;
+    void*          ctx;
+    int            events;   // CMD_EVENTS
 };
 
+struct CmdNode {
+    Cmd      c;
+    CmdNode* next;
+};
+
+// epoll data for the wake eventfd; registered fds carry (gen << 32) | fd
+static const uint64_t WAKE_TAG = ~(uint64_t)0;
+static const int MAX_EVENTS = 256;
+
 struct reactor {
-    struct Watch { int fd; reactorFunc cb; };
+    // one slot per fd number, holding either a plain or a ctx callback;
+    // neither set means the slot is free. gen is bumped whenever a
+    // registration ends, so readiness reported for an old registration
+    // is never delivered to a reused fd.
+    struct Slot {
+        reactorFunc    cb;
+        reactorCtxFunc ctxcb;
+        void*          ctx;
+        uint32_t       gen;
+
+        bool used() const { return cb || ctxcb; }
+    };
 
-    std::vector<Watch> watches;   // mutated ONLY in reactor thread
-    int wake_pipe[2];             // [0]=read, [1]=write (both nonblocking)
+    std::vector<Slot> slots;      // indexed by fd, mutated ONLY in reactor thread
+    int epfd;
+    int wakefd;                   // eventfd, written once per batch of commands
+    std::atomic<CmdNode*> cmds;   // pushed by any thread, newest first
     std::thread loopThread;
     std::atomic<bool> running;
 
-    reactor() : watches(), wake_pipe{-1,-1}, running(false) {}
+    reactorOptions opts;
+    int spinUs;                   // current busy-poll window, adapts in [0, opts.busy_poll_us]
+
+    reactor() : slots(), epfd(-1), wakefd(-1), cmds(NULL), running(false), opts(), spinUs(0) {
+        opts.cpu = -1;
+    }
 };
 
-// best-effort, nonblocking
-static void sendCmd(reactor* R, const Cmd& c) {
-    if (!R) return;
-    (void)!write(R->wake_pipe[1], &c, sizeof(c));
+static uint64_t slotTag(int fd, uint32_t gen) {
+    return ((uint64_t)gen << 32) | (uint32_t)fd;
+}
+
+static void wake(reactor* R) {
+    uint64_t one = 1;
+    (void)!write(R->wakefd, &one, sizeof(one));
+}
+
+// lock-free push; only the producer that finds the queue empty pays for
+// the eventfd write, everyone after it rides on the same wakeup
+static int sendCmd(reactor* R, const Cmd& c) {
+    if (!R) return -1;
+    CmdNode* n = new (std::nothrow) CmdNode{c, NULL};
+    if (!n) return -1;
+
+    CmdNode* head = R->cmds.load(std::memory_order_relaxed);
+    do {
+        n->next = head;
+    } while (!R->cmds.compare_exchange_weak(head, n,
+                std::memory_order_release, std::memory_order_relaxed));
+
+    if (!head) wake(R);
+    return 0;
+}
+
+static void applyAdd(reactor* R, const Cmd& c) {
+    int fd = c.fd;
+    if ((size_t)fd >= R->slots.size()) {
+        R->slots.resize((size_t)fd + 1, reactor::Slot{NULL, NULL, NULL, 0});
+    }
+    reactor::Slot& s = R->slots[fd];
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    bool ok = false;
+    if (s.used()) {
+        // already registered: just swap the callback
+        ev.data.u64 = slotTag(fd, s.gen);
+        ok = epoll_ctl(R->epfd, EPOLL_CTL_MOD, fd, &ev) == 0;
+        if (!ok) {
+            // fd was closed without removeFdFromReactor and the number got
+            // reused; retire the old registration before adding the new one
+            ++s.gen;
+        }
+    }
+    if (!ok) {
+        ev.data.u64 = slotTag(fd, s.gen);
+        ok = epoll_ctl(R->epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+    s.cb    = ok ? c.cb : NULL;
+    s.ctxcb = ok ? c.ctxcb : NULL;
+    s.ctx   = ok ? c.ctx : NULL;
+}
+
+static void applyRemove(reactor* R, int fd) {
+    if (fd < 0 || (size_t)fd >= R->slots.size()) return;
+    reactor::Slot& s = R->slots[fd];
+    if (!s.used()) return;
+    // may fail with EBADF if the caller already closed fd; that's fine,
+    // closing removed it from the epoll set anyway
+    (void)epoll_ctl(R->epfd, EPOLL_CTL_DEL, fd, NULL);
+    s.cb = NULL;
+    s.ctxcb = NULL;
+    s.ctx = NULL;
+    ++s.gen;
 }
 
-// read all queued commands and apply them (runs in reactor thread)
+static void applyEvents(reactor* R, int fd, int events) {
+    if (fd < 0 || (size_t)fd >= R->slots.size()) return;
+    reactor::Slot& s = R->slots[fd];
+    if (!s.used()) return;
+    epoll_event ev{};
+    if (events & REACTOR_READ) ev.events |= EPOLLIN;
+    if (events & REACTOR_WRITE) ev.events |= EPOLLOUT;
+    ev.data.u64 = slotTag(fd, s.gen);
+    (void)epoll_ctl(R->epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+// take every queued command and apply them in order (runs in reactor thread)
 static void drainAndApply(reactor* R) {
-    for (;;) {
-        Cmd c;
-        ssize_t n = read(R->wake_pipe[0], &c, sizeof(c));
-        if (n != (ssize_t)sizeof(c)) break; // pipe empty (or short read)
-        if (c.t == CMD_ADD) {
-            // update if exists, else push
-            std::vector<reactor::Watch>::iterator it =
-                std::find_if(R->watches.begin(), R->watches.end(),
-                    [&](const reactor::Watch& w){ return w.fd == c.fd; });
-            if (it != R->watches.end()) it->cb = c.cb;
-            else R->watches.push_back(reactor::Watch{c.fd, c.cb});
-        } else if (c.t == CMD_RM) {
-            R->watches.erase(
-                std::remove_if(R->watches.begin(), R->watches.end(),
-                    [&](const reactor::Watch& w){ return w.fd == c.fd; }),
-                R->watches.end());
-        } else if (c.t == CMD_STOP) {
-            R->running = false;
+    // reset the eventfd BEFORE taking the queue: a producer that pushes
+    // after the exchange sees an empty queue and writes a fresh wakeup
+    uint64_t cnt;
+    (void)!read(R->wakefd, &cnt, sizeof(cnt));
+
+    CmdNode* n = R->cmds.exchange(NULL, std::memory_order_acquire);
+
+    // the stack is newest-first; reverse it to apply in submission order
+    CmdNode* fifo = NULL;
+    while (n) {
+        CmdNode* next = n->next;
+        n->next = fifo;
+        fifo = n;
+        n = next;
+    }
+
+    while (fifo) {
+        CmdNode* next = fifo->next;
+        if (fifo->c.t == CMD_ADD) {
+            applyAdd(R, fifo->c);
+        } else if (fifo->c.t == CMD_RM) {
+            applyRemove(R, fifo->c.fd);
+        } else if (fifo->c.t == CMD_EVENTS) {
+            applyEvents(R, fifo->c.fd, fifo->c.events);
         }
+        delete fifo;
+        fifo = next;
     }
 }
 
-static void reactorLoop(reactor* R) {
-    while (R->running.load()) {
-        fd_set rfds; FD_ZERO(&rfds);
-        int maxfd = -1;
+static int64_t nowUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
 
-        // always watch the wake pipe
-        FD_SET(R->wake_pipe[0], &rfds);
-        if (R->wake_pipe[0] > maxfd) maxfd = R->wake_pipe[0];
+// Low-latency wait: spin on a non-blocking epoll_wait for up to the current
+// window before sleeping in the kernel. The window doubles when spinning
+// catches an event and halves when it does not; a blocking wait that ends
+// within the maximum window reopens it, since spinning would have caught it.
+static int waitEvents(reactor* R, epoll_event* events) {
+    int maxUs = R->opts.busy_poll_us;
+    if (maxUs <= 0) return epoll_wait(R->epfd, events, MAX_EVENTS, -1);
 
-        // watch all registered fds
-        for (size_t i = 0; i < R->watches.size(); ++i) {
-            FD_SET(R->watches[i].fd, &rfds);
-            if (R->watches[i].fd > maxfd) maxfd = R->watches[i].fd;
+    if (R->spinUs > 0) {
+        int64_t deadline = nowUs() + R->spinUs;
+        int n;
+        do {
+            n = epoll_wait(R->epfd, events, MAX_EVENTS, 0);
+        } while (n == 0 && nowUs() < deadline);
+        if (n != 0) {
+            R->spinUs = R->spinUs * 2 > maxUs ? maxUs : R->spinUs * 2;
+            return n;
         }
+        R->spinUs /= 2;
+    }
+
+    int64_t start = nowUs();
+    int n = epoll_wait(R->epfd, events, MAX_EVENTS, -1);
+    int64_t waited = nowUs() - start;
+    if (n > 0 && waited < maxUs) {
+        int want = (int)waited * 2 + 1;
+        if (want > R->spinUs) R->spinUs = want > maxUs ? maxUs : want;
+    }
+    return n;
+}
+
+static void reactorLoop(reactor* R) {
+    epoll_event events[MAX_EVENTS];
 
-        int rc = select(maxfd + 1, &rfds, NULL, NULL, NULL);
-        if (rc < 0) {
+    if (R->opts.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(R->opts.cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);  // best effort
+    }
+
+    while (R->running.load()) {
+        int n = waitEvents(R, events);
+        if (n < 0) {
             if (errno == EINTR) continue;
             break;
         }
 
         // first apply pending config changes
-        if (FD_ISSET(R->wake_pipe[0], &rfds)) {
-            drainAndApply(R);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.u64 == WAKE_TAG) {
+                drainAndApply(R);
+                break;
+            }
         }
         if (!R->running.load()) break;
 
-        // now dispatch callbacks (changes take effect next loop)
-        for (size_t i = 0; i < R->watches.size(); ++i) {
-            reactorFunc cb = R->watches[i].cb;
-            int fd = R->watches[i].fd;
-            if (cb && FD_ISSET(fd, &rfds)) {
-                (void)cb(fd); // ignore returned void*
+        // now dispatch callbacks; a slot whose generation moved on since
+        // the event was queued belongs to a different registration
+        for (int i = 0; i < n; ++i) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == WAKE_TAG) continue;
+            int fd = (int)(uint32_t)tag;
+            uint32_t gen = (uint32_t)(tag >> 32);
+            const reactor::Slot& s = R->slots[fd];
+            if (s.gen != gen) continue;
+            if (s.ctxcb) {
+                (void)s.ctxcb(fd, s.ctx); // ignore returned void*
+            } else if (s.cb) {
+                (void)s.cb(fd);
             }
         }
     }
 }
 
 void* startReactor() {
+    return startReactorOpts(NULL);
+}
+
+void* startReactorOpts(const reactorOptions* opts) {
     reactor* R = new (std::nothrow) reactor();
     if (!R) return NULL;
+    if (opts) R->opts = *opts;
+    R->spinUs = R->opts.busy_poll_us > 0 ? R->opts.busy_poll_us : 0;
 
-    if (pipe(R->wake_pipe) < 0) { delete R; return NULL; }
+    R->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (R->wakefd < 0) { delete R; return NULL; }
 
-    // make both ends nonblocking
-    for (int i = 0; i < 2; ++i) {
-        int flags = fcntl(R->wake_pipe[i], F_GETFL, 0);
-        fcntl(R->wake_pipe[i], F_SETFL, flags | O_NONBLOCK);
+    R->epfd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_TAG;
+    if (R->epfd < 0 || epoll_ctl(R->epfd, EPOLL_CTL_ADD, R->wakefd, &ev) < 0) {
+        if (R->epfd != -1) close(R->epfd);
+        close(R->wakefd);
+        delete R;
+        return NULL;
     }
 
     R->running = true;
@@ -115,15 +287,23 @@ void* startReactor() {
 }
 
 int addFdToReactor(void* rp, int fd, reactorFunc func) {
-    if (!rp || fd < 0) return -1;
-    sendCmd(static_cast<reactor*>(rp), Cmd{CMD_ADD, fd, func});
-    return 0;
+    if (!rp || fd < 0 || !func) return -1;
+    return sendCmd(static_cast<reactor*>(rp), Cmd{CMD_ADD, fd, func, NULL, NULL, 0});
+}
+
+int addFdToReactorCtx(void* rp, int fd, reactorCtxFunc func, void* ctx) {
+    if (!rp || fd < 0 || !func) return -1;
+    return sendCmd(static_cast<reactor*>(rp), Cmd{CMD_ADD, fd, NULL, func, ctx, 0});
 }
 
 int removeFdFromReactor(void* rp, int fd) {
     if (!rp) return -1;
-    sendCmd(static_cast<reactor*>(rp), Cmd{CMD_RM, fd, NULL});
-    return 0;
+    return sendCmd(static_cast<reactor*>(rp), Cmd{CMD_RM, fd, NULL, NULL, NULL, 0});
+}
+
+int setFdEvents(void* rp, int fd, int events) {
+    if (!rp || fd < 0) return -1;
+    return sendCmd(static_cast<reactor*>(rp), Cmd{CMD_EVENTS, fd, NULL, NULL, NULL, events});
 }
 
 int stopReactor(void* rp) {
@@ -131,11 +311,42 @@ int stopReactor(void* rp) {
     reactor* R = static_cast<reactor*>(rp);
 
     // tell loop to stop and join it
-    sendCmd(R, Cmd{CMD_STOP, -1, NULL});
+    R->running = false;
+    wake(R);
     if (R->loopThread.joinable()) R->loopThread.join();
 
-    if (R->wake_pipe[0] != -1) close(R->wake_pipe[0]);
-    if (R->wake_pipe[1] != -1) close(R->wake_pipe[1]);
+    // commands that arrived after the last drain are simply dropped
+    CmdNode* n = R->cmds.exchange(NULL, std::memory_order_acquire);
+    while (n) {
+        CmdNode* next = n->next;
+        delete n;
+        n = next;
+    }
+
+    if (R->epfd != -1) close(R->epfd);
+    if (R->wakefd != -1) close(R->wakefd);
     delete R;
     return 0;
+}
+
+int setBusyPoll(int fd, int usec) {
+    if (fd < 0 || usec <= 0) return -1;
+    return setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec));
+}
+
+int openSignalFd(const int* signals, int n) {
+    if (!signals || n <= 0) return -1;
+    sigset_t set;
+    sigemptyset(&set);
+    for (int i = 0; i < n; ++i) sigaddset(&set, signals[i]);
+    if (pthread_sigmask(SIG_BLOCK, &set, NULL) != 0) return -1;
+    return signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+int readSignal(int sigfd) {
+    signalfd_siginfo si;
+    ssize_t n = read(sigfd, &si, sizeof(si));
+    if (n == (ssize_t)sizeof(si)) return (int)si.ssi_signo;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    return -1;
 }
\ No newline at end of file
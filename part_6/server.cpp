@@ -1,62 +1,268 @@
 #include "Graph.hpp"
 #include "reactor.hpp"
-#include <iostream>
+#include "WorkerPool.hpp"
+#include "ShmRing.hpp"
+#include "WireProtocol.hpp"
+#include "InputBuffer.hpp"
+#include "CommandTable.hpp"
+#include "ReplyWriter.hpp"
 #include <vector>
+#include <cstdlib>
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <string_view>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <sys/un.h>
 #include <unistd.h>
-#include <map>
+#include <deque>
+#include <memory>
+#include <thread>
 #include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <fstream>
+#include <unordered_set>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 
 
 static constexpr int PORT = 9034;
+static constexpr const char* UNIX_PATH = "/tmp/graph_server.sock";  // same protocol, no TCP stack
+static constexpr size_t READ_MIN = 4096;    // free space offered to each recv
+static constexpr size_t MAX_LINE = 1 << 20;  // a text line still without '\n' past this ends the connection
+static constexpr int MAX_PASSED_FDS = 3;     // a Shmgraph upload: memfd + two eventfds
+static constexpr size_t OFFLOAD_MIN_POINTS = 1024;  // smaller CH requests stay inline
+static constexpr int MAX_CONNS = 4096;
+// replies a client may leave unread behind the one being sent before it is
+// dropped; one reply (a hull) alone can be bigger
+static constexpr size_t MAX_BACKLOG = 16 << 20;
+static constexpr double CONN_RATE_PER_SOURCE = 200.0;  // new connections per second
+static constexpr int CONN_BURST_PER_SOURCE = 400;
+// SIGHUP re-reads CONFIG_PATH (if present) and writes the graph to SNAPSHOT_PATH;
+// SIGTERM/SIGINT stop accepting and close clients once their replies are out
+static constexpr const char* CONFIG_PATH = "server.conf";
+static constexpr const char* SNAPSHOT_PATH = "graph.snapshot";
+static constexpr int DRAIN_TIMEOUT_MS = 5000;
+// low-latency mode, off by default: it burns a core while idle
+static constexpr int REACTOR_CPU = -1;      // pin the reactor thread, -1 = let the scheduler decide
+static constexpr int BUSY_POLL_US = 0;      // spin this long before sleeping in epoll_wait
 static Graph gGraph;
 
+struct PendingReply {
+    bool ready;
+    std::string text;
+};
+
+enum Protocol { PROTO_UNKNOWN, PROTO_TEXT, PROTO_BINARY };
+
 struct ConnState {
-    std::string inbuf;            // bytes accumulated until '\n'
+    Protocol proto = PROTO_UNKNOWN; // decided by the first byte the client sends
+    InputBuffer in;               // received, not yet parsed; parsed in place
+    size_t need = 0;              // bytes still missing from a partial frame
     int expect_points = 0;        // >0 means NewGraph is waiting for N point lines
     std::vector<Point> pending;   // temp points for NewGraph
+    int fd = -1;
+    std::deque<PendingReply> outq; // replies in request order, some still computing
+    uint64_t outBase = 0;         // sequence number of outq.front()
+    size_t outSent = 0;           // bytes of outq.front() already sent
+    size_t outBytes = 0;          // finished replies in outq, not yet sent
+    int events = REACTOR_READ;    // what the reactor wakes us for
+    int inflight = 0;             // jobs on the worker pool that point at us
+    bool closed = false;          // client left; freed once inflight drops to 0
+    std::vector<int> passedFds;   // arrived over the Unix socket, waiting for Shmgraph
+    ShmRing* ring = nullptr;      // Shmgraph upload in progress
+    size_t ringExpect = 0;        // points still to come through the ring
+    uint64_t ringSeq = 0;         // reply slot the upload answers in
 };
 
 static void* gReactor = nullptr;
-static std::map<int, ConnState> gConns;
+static WorkerPool* gPool = nullptr;
+static void* gAdmission = nullptr;
+
+// the tunables a reload may change; starts out as the constants above
+struct ServerConfig {
+    size_t offload_min_points = OFFLOAD_MIN_POINTS;
+    int max_conns = MAX_CONNS;
+    double conn_rate_per_source = CONN_RATE_PER_SOURCE;
+    int conn_burst_per_source = CONN_BURST_PER_SOURCE;
+};
+static ServerConfig gConfig;
+
+// reactor thread only
+static std::unordered_set<ConnState*> gConns;
+static int gListenFd = -1;
+static int gUnixListenFd = -1;
+// ring dataFd -> its connection. A lookup rather than a reactor ctx so a
+// wakeup that was already queued when the connection closed finds nothing.
+static std::unordered_map<int, ConnState*> gUploads;
+static bool gDraining = false;
+
+// main sleeps on this until the drain is over
+static std::mutex gExitMtx;
+static std::condition_variable gExitCv;
+static bool gDrainStarted = false;
+static bool gDrained = false;
+
+
+static void* onShmData(int fd);
+
+// Shmgraph n: the n points come through a shared-memory ring instead of n
+// text lines; the client sent the ring's fds along with this command.
+static std::string startShmUpload(ConnState& st, int n) {
+    if (st.ring) return "Upload already in progress\n";
+    if (st.passedFds.size() != 3) return "Shmgraph needs a ring (Unix socket only)\n";
+    ShmRing* ring = ShmRing::attach(st.passedFds[0], st.passedFds[1], st.passedFds[2]);
+    st.passedFds.clear();                     // owned (or closed) by attach now
+    if (!ring) return "Invalid ring\n";
+
+    st.ring = ring;
+    st.ringExpect = n;
+    st.pending.clear();
+    st.ringSeq = st.outBase + st.outq.size();
+    st.outq.push_back(PendingReply{false, std::string()});
+    gUploads[ring->dataFd()] = &st;
+    addFdToReactor(gReactor, ring->dataFd(), onShmData);
+    // Points may be there already, but the first drain goes through the
+    // reactor like every other: run from here it could flush, close and
+    // free st under the caller's line loop.
+    uint64_t one = 1;
+    (void)!write(ring->dataFd(), &one, sizeof(one));
+    return "";
+}
+
+// one per command: the reply, or "" for none yet (or a job, see processLine);
+// args is what follows the name
+typedef std::string (*CommandHandler)(ConnState& st, std::string_view line, std::string_view args,
+                                      WorkerPool::Job& job);
 
-static volatile sig_atomic_t gStopFlag = 0;
-static void on_stop(int) {
-    gStopFlag = 1;
+static std::string onShmgraph(ConnState& st, std::string_view, std::string_view args, WorkerPool::Job&) {
+    std::istringstream in{std::string(args)};
+    int n;
+    if (!(in >> n) || n < 0 || (in >> std::ws, !in.eof())) {
+        return "Invalid Shmgraph count\n";
+    }
+    return startShmUpload(st, n);
 }
 
+static std::string onNewgraph(ConnState& st, std::string_view, std::string_view args, WorkerPool::Job&) {
+    std::istringstream in{std::string(args)};
+    int n; 
+    if (!(in >> n) || n < 0 || (in >> std::ws, !in.eof())) {
+        return "Invalid Newgraph count\n";
+    }
+    st.expect_points = n;
+    st.pending.clear();
+    if (n == 0) {
+        gGraph.newGraph({});
+        st.expect_points = 0;
+        return "New graph created\n";
+    }
+    return ""; // wait for the n point lines
+}
 
-void sendAll(int fd, const std::string& message) {
-    const char* msg = message.data();
-    size_t msgLength = message.size();
-    while(msgLength > 0) {
-        ssize_t n = send(fd, msg, msgLength, 0);
-        if (n < 0) {
-            std::cerr << "Error sending data\n";
-            return;
-        }
-        msg += n;
-        msgLength -= n;
+static std::string onCH(ConnState&, std::string_view, std::string_view, WorkerPool::Job& job) {
+    if (gGraph.getPoints().size() >= gConfig.offload_min_points) {
+        // hull runs on a worker against a copy, mutations keep going here
+        std::shared_ptr<Graph> snap = std::make_shared<Graph>(gGraph);
+        job = [snap]() {
+            std::string out;
+            ReplyWriter(out) << "Area = " << snap->area() << "\n";
+            return out;
+        };
+        return "";
+    }
+    double area = gGraph.area();
+    std::string out;
+    ReplyWriter(out) << "Area = " << area << "\n";
+    return out;
+}
+
+static std::string onNewpoint(ConnState&, std::string_view line, std::string_view args, WorkerPool::Job&) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    if (!(in >> x >> comma >> y) || comma != ',' || (in >> std::ws, !in.eof())) {
+        std::string err; ReplyWriter(err) << "Invalid point format: " << line << "\n";
+        return err;
+    }
+    if (!gGraph.addPoint(Point{x, y})) {
+        return "Failed to add point (duplicate)\n";
+    }
+    return "Point added\n";
+}
+
+static std::string onRemovepoint(ConnState&, std::string_view line, std::string_view args, WorkerPool::Job&) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    if (!(in >> x >> comma >> y) || comma != ',' || (in >> std::ws, !in.eof())) {
+        std::string err; ReplyWriter(err) << "Invalid point format: " << line << "\n";
+        return err;
+    }
+    if (!gGraph.removePoint(Point{x, y})) {
+        return "Failed to remove point (not found)\n";
+    }
+    return "Point removed\n";
+}
+
+static std::string onAddedge(ConnState&, std::string_view line, std::string_view args, WorkerPool::Job&) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char c1, c2;
+    if (!(in >> x1 >> c1 >> y1 >> x2 >> c2 >> y2) || c1 != ',' || c2 != ',' || (in >> std::ws, !in.eof())) {
+        std::string err; ReplyWriter(err) << "Invalid edge format: " << line << "\n";
+        return err;
     }
+    if (!gGraph.addEdge(Point{x1, y1}, Point{x2, y2})) {
+        return "Failed to add edge\n";
+    }
+    return "Edge added\n";
 }
 
+static std::string onRemoveedge(ConnState&, std::string_view line, std::string_view args, WorkerPool::Job&) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char c1, c2;
+    if (!(in >> x1 >> c1 >> y1 >> x2 >> c2 >> y2) || c1 != ',' || c2 != ',' || (in >> std::ws, !in.eof())) {
+        std::string err; ReplyWriter(err) << "Invalid edge format: " << line << "\n";
+        return err;
+    }
+    if (!gGraph.removeEdge(Point{x1, y1}, Point{x2, y2})) {
+        return "Failed to remove edge\n";
+    }
+    return "Edge removed\n";
+}
 
-static std::string processLine(ConnState& st, const std::string& rawLine) {
-    std::string line = rawLine;
-    if (!line.empty() && line.back() == '\r') line.pop_back();
+static std::string onUnknown(ConnState&, std::string_view, std::string_view, WorkerPool::Job&) {
+    return "Unknown command\n";
+}
 
+static constexpr CommandDispatch<CommandHandler> COMMANDS{onUnknown, {
+    {CMD_SHMGRAPH, onShmgraph},
+    {CMD_NEWGRAPH, onNewgraph},
+    {CMD_CH, onCH},
+    {CMD_NEWPOINT, onNewpoint},
+    {CMD_REMOVEPOINT, onRemovepoint},
+    {CMD_ADDEDGE, onAddedge},
+    {CMD_REMOVEEDGE, onRemoveedge},
+}};
+
+// Returns the reply for line (already without '\n' / '\r'), or leaves it
+// empty and fills `job` when the command is too heavy for the reactor thread.
+static std::string processLine(ConnState& st, std::string_view line, WorkerPool::Job& job) {
     // If we're in the middle of NewGraph, treat the line as a point.
     if (st.expect_points > 0) {
         double x, y; char comma;
-        std::istringstream ptin(line);
+        std::istringstream ptin{std::string(line)};
         if (!(ptin >> x >> comma >> y) || comma != ',' || (ptin >> std::ws, !ptin.eof())) {
-            std::ostringstream err; err << "Invalid point format: " << line << "\n";
+            std::string err; ReplyWriter(err) << "Invalid point format: " << line << "\n";
             st.expect_points = 0; st.pending.clear();
-            return err.str();
+            return err;
         }
         st.pending.push_back(Point{x, y});
         if (--st.expect_points == 0) {
@@ -70,132 +276,456 @@ static std::string processLine(ConnState& st, const std::string& rawLine) {
     // Otherwise parse a command line
     if (line.empty()) return "";
 
-    std::istringstream in(line);
-    std::string cmd; in >> cmd;
+    std::string_view args;
+    std::string_view cmd = splitCommand(line, args);
+    return COMMANDS.find(cmd)(st, line, args, job);
+}
+
+static std::string errorFrame(const char* msg) {
+    return wireFrame(OP_ERROR, msg);
+}
 
-    if (cmd == "Newgraph") {
-        int n; 
-        if (!(in >> n) || n < 0 || (in >> std::ws, !in.eof())) {
-            return "Invalid Newgraph count\n";
+// Binary counterpart of processLine: the reply frame for one request, or
+// an empty string and a `job` for a hull too big for the reactor thread.
+static std::string processFrame(uint8_t op, const char* p, size_t len, WorkerPool::Job& job) {
+    switch (op) {
+    case OP_NEWGRAPH: {
+        std::vector<Point> pts;
+        if (!wireGetPoints(p, len, pts)) return errorFrame("Invalid Newgraph payload");
+        gGraph.newGraph(pts);
+        return wireFrame(OP_OK, "");
+    }
+    case OP_CH:
+    case OP_HULL: {
+        if (len != 0) return errorFrame("Unexpected payload");
+        bool hull = op == OP_HULL;
+        if (gGraph.getPoints().size() >= gConfig.offload_min_points) {
+            std::shared_ptr<Graph> snap = std::make_shared<Graph>(gGraph);
+            job = [snap, hull]() {
+                std::string out;
+                if (hull) wirePutPoints(out, snap->convexHull());
+                else wirePutF64(out, snap->area());
+                return wireFrame(hull ? OP_POINTS : OP_AREA, out);
+            };
+            return "";
         }
-        st.expect_points = n;
-        st.pending.clear();
-        if (n == 0) {
-            gGraph.newGraph({});
-            st.expect_points = 0;
-            return "New graph created\n";
+        std::string out;
+        if (hull) wirePutPoints(out, gGraph.convexHull());
+        else wirePutF64(out, gGraph.area());
+        return wireFrame(hull ? OP_POINTS : OP_AREA, out);
+    }
+    case OP_NEWPOINT:
+    case OP_REMOVEPOINT: {
+        if (len != WIRE_POINT) return errorFrame("Invalid point payload");
+        Point pt = wireGetPoint(p);
+        if (!wireFinite(pt)) return errorFrame("Invalid point payload");
+        if (op == OP_NEWPOINT) {
+            if (!gGraph.addPoint(pt)) return errorFrame("Failed to add point (duplicate)");
+        } else {
+            if (!gGraph.removePoint(pt)) return errorFrame("Failed to remove point (not found)");
         }
-        return ""; // wait for the n point lines
+        return wireFrame(OP_OK, "");
+    }
+    case OP_ADDEDGE:
+    case OP_REMOVEEDGE: {
+        if (len != 2 * WIRE_POINT) return errorFrame("Invalid edge payload");
+        Point a = wireGetPoint(p), b = wireGetPoint(p + WIRE_POINT);
+        if (!wireFinite(a) || !wireFinite(b)) return errorFrame("Invalid edge payload");
+        bool ok = op == OP_ADDEDGE ? gGraph.addEdge(a, b) : gGraph.removeEdge(a, b);
+        if (!ok) return errorFrame(op == OP_ADDEDGE ? "Failed to add edge" : "Failed to remove edge");
+        return wireFrame(OP_OK, "");
+    }
+    }
+    return errorFrame("Unknown opcode");
+}
 
-    } else if (cmd == "CH") {
-        double area = gGraph.area();
-        std::ostringstream out;
-        out << "Area = " << area << "\n";
-        return out.str();
+static void closeConn(ConnState* st);
 
-    } else if (cmd == "Newpoint") {
-        double x, y; char comma;
-        if (!(in >> x >> comma >> y) || comma != ',' || (in >> std::ws, !in.eof())) {
-            std::ostringstream err; err << "Invalid point format: " << line << "\n";
-            return err.str();
-        }
-        if (!gGraph.addPoint(Point{x, y})) {
-            return "Failed to add point (duplicate)\n";
-        }
-        return "Point added\n";
+static void setEvents(ConnState& st, int events) {
+    if (st.events == events) return;
+    st.events = events;
+    setFdEvents(gReactor, st.fd, events);
+}
 
-    } else if (cmd == "Removepoint") {
-        double x, y; char comma;
-        if (!(in >> x >> comma >> y) || comma != ',' || (in >> std::ws, !in.eof())) {
-            std::ostringstream err; err << "Invalid point format: " << line << "\n";
-            return err.str();
+// Send every reply at the head of the queue that is done computing, all
+// in one writev so a pipelined batch leaves as one segment. What the socket
+// won't take stays queued: EPOLLOUT brings us back, and reading stops
+// until then, so a client that doesn't read can't pile up more requests.
+// Never waits. false if the connection was closed (st is gone).
+static bool flushReplies(ConnState& st) {
+    while (!st.outq.empty() && st.outq.front().ready) {
+        iovec iov[IOV_MAX];
+        int cnt = 0;
+        for (size_t i = 0; i < st.outq.size() && cnt < IOV_MAX && st.outq[i].ready; ++i) {
+            size_t skip = i == 0 ? st.outSent : 0;
+            iov[cnt].iov_base = const_cast<char*>(st.outq[i].text.data()) + skip;
+            iov[cnt].iov_len = st.outq[i].text.size() - skip;
+            ++cnt;
         }
-        if (!gGraph.removePoint(Point{x, y})) {
-            return "Failed to remove point (not found)\n";
-        }
-        return "Point removed\n";
-
-    } else if (cmd == "Addedge") {
-        double x1, y1, x2, y2; char c1, c2;
-        if (!(in >> x1 >> c1 >> y1 >> x2 >> c2 >> y2) || c1 != ',' || c2 != ',' || (in >> std::ws, !in.eof())) {
-            std::ostringstream err; err << "Invalid edge format: " << line << "\n";
-            return err.str();
+        ssize_t n = writev(st.fd, iov, cnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            logPrintf(LOG_LEVEL_ERROR, "Error sending data");
+            closeConn(&st);
+            return false;
         }
-        if (!gGraph.addEdge(Point{x1, y1}, Point{x2, y2})) {
-            return "Failed to add edge\n";
+        size_t sent = n;
+        while (!st.outq.empty() && st.outq.front().ready) {   // drop what went out
+            size_t rest = st.outq.front().text.size() - st.outSent;
+            if (sent < rest) {
+                st.outSent += sent;
+                break;
+            }
+            sent -= rest;
+            st.outBytes -= st.outq.front().text.size();
+            st.outq.pop_front();
+            ++st.outBase;
+            st.outSent = 0;
         }
-        return "Edge added\n";
+    }
+
+    bool blocked = !st.outq.empty() && st.outq.front().ready;
+    size_t backlog = st.outBytes - (blocked ? st.outq.front().text.size() : 0);
+    if (backlog > MAX_BACKLOG) {
+        logPrintf(LOG_LEVEL_WARN, "Client not reading its replies, closing");
+        closeConn(&st);
+        return false;
+    }
+    // draining: nothing more is read, and the connection goes once the
+    // replies it is owed are out
+    if (gDraining && !blocked && st.inflight == 0) {
+        closeConn(&st);
+        return false;
+    }
+    setEvents(st, blocked ? REACTOR_WRITE : gDraining ? 0 : REACTOR_READ);
+    return true;
+}
+
+static void signalDrained() {
+    std::lock_guard<std::mutex> lock(gExitMtx);
+    gDrained = true;
+    gExitCv.notify_one();
+}
+
+static void endShmUpload(ConnState* st) {
+    gUploads.erase(st->ring->dataFd());
+    removeFdFromReactor(gReactor, st->ring->dataFd());
+    delete st->ring;
+    st->ring = nullptr;
+}
 
-    } else if (cmd == "Removeedge") {
-        double x1, y1, x2, y2; char c1, c2;
-        if (!(in >> x1 >> c1 >> y1 >> x2 >> c2 >> y2) || c1 != ',' || c2 != ',' || (in >> std::ws, !in.eof())) {
-            std::ostringstream err; err << "Invalid edge format: " << line << "\n";
-            return err.str();
+static void closeConn(ConnState* st) {
+    if (st->ring) endShmUpload(st);           // client gave up mid-upload
+    for (size_t i = 0; i < st->passedFds.size(); ++i) close(st->passedFds[i]);
+    st->passedFds.clear();
+    removeFdFromReactor(gReactor, st->fd);
+    close(st->fd);
+    releaseConnection(gAdmission);
+    st->closed = true;
+    gConns.erase(st);
+    if (st->inflight == 0) delete st;
+    logPrintf(LOG_LEVEL_INFO, "Client disconnected");
+    if (gDraining && gConns.empty()) signalDrained();
+}
+
+static void* onWorkerDone(int efd) {
+    (void)efd;
+    std::vector<WorkerPool::Done> done = gPool->takeCompleted();
+    for (size_t i = 0; i < done.size(); ++i) {
+        ConnState* st = static_cast<ConnState*>(done[i].ctx);
+        --st->inflight;
+        if (st->closed) {                       // client left meanwhile
+            if (st->inflight == 0) delete st;
+            continue;
         }
-        if (!gGraph.removeEdge(Point{x1, y1}, Point{x2, y2})) {
-            return "Failed to remove edge\n";
+        PendingReply& slot = st->outq[done[i].seq - st->outBase];
+        slot.ready = true;
+        slot.text.swap(done[i].reply);
+        st->outBytes += slot.text.size();
+        flushReplies(*st);                      // while draining, closes once the last reply is out
+    }
+    return nullptr;
+}
+
+// A reply is queued behind any earlier ones still computing (the caller
+// flushes once per read batch); a job gets a reply slot and runs on the pool.
+static void queueReply(ConnState& st, std::string& reply, WorkerPool::Job& job) {
+    if (job) {
+        uint64_t seq = st.outBase + st.outq.size();
+        st.outq.push_back(PendingReply{false, std::string()});
+        ++st.inflight;
+        gPool->post(&st, seq, job);
+    } else if (!reply.empty()) {
+        st.outq.push_back(PendingReply{true, std::string()});
+        st.outq.back().text.swap(reply);
+        st.outBytes += st.outq.back().text.size();
+    }
+}
+
+static void* onShmData(int fd) {
+    std::unordered_map<int, ConnState*>::iterator it = gUploads.find(fd);
+    if (it == gUploads.end()) return nullptr;
+    ConnState* st = it->second;
+
+    bool finite = true;
+    while (st->ringExpect > 0 && finite) {
+        size_t from = st->pending.size();
+        size_t got = st->ring->pop(st->pending, st->ringExpect);
+        if (got == 0) return nullptr;         // producer is still writing
+        st->ringExpect -= got;
+        for (size_t i = from; i < st->pending.size() && finite; ++i) {
+            finite = wireFinite(st->pending[i]);   // raw doubles, like a frame's
         }
-        return "Edge removed\n";
     }
 
-    return "Unknown command\n";
+    PendingReply& slot = st->outq[st->ringSeq - st->outBase];
+    slot.ready = true;
+    if (finite) {
+        gGraph.newGraph(st->pending);
+        slot.text = "New graph created\n";
+    } else {
+        slot.text = "Invalid point in ring\n";
+    }
+    st->pending.clear();
+    st->outBytes += slot.text.size();
+    endShmUpload(st);
+    flushReplies(*st);
+    return nullptr;
+}
+
+// recvmsg rather than recv: a Unix socket client may pass fds along
+static ssize_t recvWithFds(int fd, char* buf, size_t len, std::vector<int>& fds) {
+    iovec iov{buf, len};
+    union {
+        cmsghdr align;
+        char space[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+    } ctl;
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.space;
+    msg.msg_controllen = sizeof(ctl.space);
+
+    ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); n > 0 && c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const int* passed = reinterpret_cast<const int*>(CMSG_DATA(c));
+        for (size_t i = 0; i < count; ++i) {
+            if (fds.size() < (size_t)MAX_PASSED_FDS) fds.push_back(passed[i]);
+            else close(passed[i]);
+        }
+    }
+    return n;
 }
 
-static void* onClientRead(int fd) {
-    ConnState& st = gConns[fd];
-    char buf[4096];
-    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+// readable, or (while replies are stuck) writable
+static void* onClientReady(int fd, void* ctx) {
+    ConnState& st = *static_cast<ConnState*>(ctx);
+    if (st.events & REACTOR_WRITE) {
+        flushReplies(st);
+        return nullptr;
+    }
+
+    // receive straight into the buffer; a big frame gets its room up front
+    size_t avail;
+    char* dst = st.in.prepare(st.need > READ_MIN ? st.need : READ_MIN, avail);
+    ssize_t n = recvWithFds(fd, dst, avail, st.passedFds);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return nullptr;
     if (n <= 0) {
-        removeFdFromReactor(gReactor, fd);
-        close(fd);
-        gConns.erase(fd);
-        std::cout << "Client disconnected\n";
+        closeConn(&st);
         return nullptr;
     }
+    st.in.commit(n);
+
+    if (st.proto == PROTO_UNKNOWN) {
+        if ((unsigned char)st.in.data()[0] == WIRE_MAGIC) {
+            st.proto = PROTO_BINARY;
+            st.in.consume(1);
+        } else {
+            st.proto = PROTO_TEXT;
+        }
+    }
 
-    st.inbuf.append(buf, n);
+    if (st.proto == PROTO_BINARY) {
+        // Process all complete frames
+        st.need = 0;
+        for (;;) {
+            std::string_view buf = st.in.data();
+            if (buf.size() < WIRE_HEADER) break;
+            uint8_t op = (uint8_t)buf[0];
+            uint32_t len = wireGetU32(buf.data() + 1);
+            if (len > WIRE_MAX_PAYLOAD) {
+                // best effort: the client is dropped whether it reads this or not
+                std::string err = errorFrame("Frame too large");
+                (void)!send(fd, err.data(), err.size(), MSG_DONTWAIT);
+                closeConn(&st);
+                return nullptr;
+            }
+            if (buf.size() - WIRE_HEADER < len) {
+                st.need = WIRE_HEADER + len - buf.size();
+                break;
+            }
+
+            WorkerPool::Job job;
+            std::string reply = processFrame(op, buf.data() + WIRE_HEADER, len, job);
+            st.in.consume(WIRE_HEADER + len);
+            queueReply(st, reply, job);
+        }
+        flushReplies(st);
+        return nullptr;
+    }
 
     // Process all complete lines
+    std::string_view line;
+    while (st.in.nextLine(line)) {
+        WorkerPool::Job job;
+        std::string reply = processLine(st, line, job);
+        queueReply(st, reply, job);
+    }
+    if (st.in.data().size() > MAX_LINE) {      // what is left is one partial line
+        if (!flushReplies(st)) return nullptr;
+        (void)!send(fd, "Line too long\n", 14, MSG_DONTWAIT);
+        closeConn(&st);
+        return nullptr;
+    }
+    flushReplies(st);
+    return nullptr;
+}
+
+static void* onAccept(int fd) {
+    // The listener is nonblocking: take every pending connection now
+    // rather than one per wakeup.
     for (;;) {
-        std::string::size_type pos = st.inbuf.find('\n');
-        if (pos == std::string::npos) break;
+        sockaddr_storage peer;
+        socklen_t len = sizeof(peer);
+        int clientfd = accept4(fd, (sockaddr*)&peer, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientfd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) logPrintf(LOG_LEVEL_ERROR, "accept: %m");
+            return nullptr;
+        }
 
-        std::string line = st.inbuf.substr(0, pos + 1);
-        st.inbuf.erase(0, pos + 1);
+        if (!admitConnection(gAdmission, (sockaddr*)&peer)) {
+            // over budget: tell the client instead of leaving it hanging
+            (void)!send(clientfd, "Server busy\n", 12, MSG_DONTWAIT);
+            close(clientfd);
+            continue;
+        }
 
-        std::string reply = processLine(st, line);
-        if (!reply.empty()) {
-            sendAll(fd, reply);
+        ConnState* st = new ConnState();
+        st->fd = clientfd;
+        if (addFdToReactorCtx(gReactor, clientfd, onClientReady, st) < 0) {
+            close(clientfd);
+            releaseConnection(gAdmission);
+            delete st;
+            continue;
         }
+        gConns.insert(st);
+        // replies are coalesced per read batch, so Nagle would only add delay
+        int one = 1;
+        if (peer.ss_family != AF_UNIX) setsockopt(clientfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (BUSY_POLL_US > 0) setBusyPoll(clientfd, BUSY_POLL_US);
+        logPrintf(LOG_LEVEL_INFO, "Client connected");
     }
-    return nullptr;
 }
 
-static void* onAccept(int fd) {
-    // Accept the new connection
-    int clientfd = accept(fd, nullptr, nullptr);
-    if (clientfd < 0) {
-        perror("accept");
-        return nullptr;
+// "key value" lines, '#' comments; unknown keys are reported and skipped
+static bool loadConfig(const char* path, ServerConfig& cfg) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        std::string key;
+        if (!(ls >> key) || key[0] == '#') continue;
+        bool ok = true;
+        if (key == "offload_min_points") ok = static_cast<bool>(ls >> cfg.offload_min_points);
+        else if (key == "max_conns") ok = static_cast<bool>(ls >> cfg.max_conns);
+        else if (key == "conn_rate_per_source") ok = static_cast<bool>(ls >> cfg.conn_rate_per_source);
+        else if (key == "conn_burst_per_source") ok = static_cast<bool>(ls >> cfg.conn_burst_per_source);
+        else logPrintf(LOG_LEVEL_WARN, "%s: unknown key %s", path, key.c_str());
+        if (!ok) logPrintf(LOG_LEVEL_WARN, "%s: bad value for %s", path, key.c_str());
     }
+    return true;
+}
+
+static admissionConfig admissionFor(const ServerConfig& cfg) {
+    admissionConfig adm;
+    adm.max_conns = cfg.max_conns;
+    adm.rate_per_sec = cfg.conn_rate_per_source;
+    adm.burst = cfg.conn_burst_per_source;
+    return adm;
+}
+
+// in Newgraph form, so the file can be replayed through a client;
+// written to a temp file first so a crash never leaves half a snapshot
+static bool writeSnapshot(const char* path) {
+    std::string tmp = std::string(path) + ".tmp";
+    {
+        std::ofstream out(tmp.c_str());
+        if (!out) return false;
+        const std::vector<Point>& pts = gGraph.getPoints();
+        out << "Newgraph " << pts.size() << "\n";
+        for (size_t i = 0; i < pts.size(); ++i) out << pts[i].x << "," << pts[i].y << "\n";
+        if (!out.flush()) return false;
+    }
+    return std::rename(tmp.c_str(), path) == 0;
+}
 
-    addFdToReactor(gReactor, clientfd, onClientRead);
-    gConns.emplace(clientfd, ConnState{});
-    std::cout << "Client connected\n";
+// Graceful stop: no new connections or requests, but replies already
+// being computed or waiting for socket space are still delivered before
+// their connection closes.
+static void startDrain() {
+    if (gDraining) return;
+    gDraining = true;
+    {
+        std::lock_guard<std::mutex> lock(gExitMtx);
+        gDrainStarted = true;
+        gExitCv.notify_one();
+    }
+    removeFdFromReactor(gReactor, gListenFd);
+    removeFdFromReactor(gReactor, gUnixListenFd);
+    std::vector<ConnState*> conns(gConns.begin(), gConns.end());
+    for (size_t i = 0; i < conns.size(); ++i) flushReplies(*conns[i]);
+    if (gConns.empty()) signalDrained();
+}
+
+static void* onSignal(int sigfd) {
+    int sig;
+    while ((sig = readSignal(sigfd)) > 0) {
+        if (sig == SIGHUP) {
+            if (loadConfig(CONFIG_PATH, gConfig)) {
+                admissionConfig adm = admissionFor(gConfig);
+                updateAdmission(gAdmission, &adm);
+                logPrintf(LOG_LEVEL_INFO, "Reloaded %s", CONFIG_PATH);
+            }
+            if (writeSnapshot(SNAPSHOT_PATH)) logPrintf(LOG_LEVEL_INFO, "Snapshot written to %s", SNAPSHOT_PATH);
+            else logPrintf(LOG_LEVEL_ERROR, "Error writing snapshot");
+        } else {
+            logPrintf(LOG_LEVEL_INFO, "Draining connections...");
+            startDrain();
+        }
+    }
     return nullptr;
 }
 
 int main() {
     signal(SIGPIPE, SIG_IGN);
-    struct sigaction sa;
-    sa.sa_handler = on_stop;
-    sigaction(SIGINT, &sa, nullptr);
-    sigaction(SIGTERM, &sa, nullptr);
+    // before any thread exists, so none of them ever takes these signals
+    const int sigs[] = {SIGINT, SIGTERM, SIGHUP};
+    int sigfd = openSignalFd(sigs, 3);
+    if (sigfd < 0) { logPrintf(LOG_LEVEL_ERROR, "Error creating signalfd"); return 1; }
+    // after the signal mask is set, so the flusher thread inherits it; atexit
+    // writes out whatever is still queued on every way out of main
+    if (startLogger(LOG_LEVEL_INFO) == 0) atexit(stopLogger);
+    loadConfig(CONFIG_PATH, gConfig);
 
-    std::cout << "Starting Graph server on port " << PORT << "...\n";
+    logPrintf(LOG_LEVEL_INFO, "Starting Graph server on port %d...", PORT);
 
     int listenfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenfd < 0) { std::cerr << "Error creating socket\n"; return 1; }
+    if (listenfd < 0) { logPrintf(LOG_LEVEL_ERROR, "Error creating socket"); return 1; }
 
     int yes = 1;
     setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
@@ -205,31 +735,76 @@ int main() {
     serverAddr.sin_addr.s_addr = INADDR_ANY;
     serverAddr.sin_port = htons(PORT);
     if (bind(listenfd, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        std::cerr << "Error binding socket\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error binding socket");
         close(listenfd);
         return 1;
     }
 
     if (listen(listenfd, SOMAXCONN) < 0) {
-        std::cerr << "Error listening on socket\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error listening on socket");
         close(listenfd);
         return 1;
     }
+    fcntl(listenfd, F_SETFL, fcntl(listenfd, F_GETFL, 0) | O_NONBLOCK);
+
+    // Unix socket for clients on this host
+    int unixfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_un unixAddr{};
+    unixAddr.sun_family = AF_UNIX;
+    strncpy(unixAddr.sun_path, UNIX_PATH, sizeof(unixAddr.sun_path) - 1);
+    unlink(UNIX_PATH);                        // left over from a previous run
+    if (unixfd < 0 || bind(unixfd, (sockaddr*)&unixAddr, sizeof(unixAddr)) < 0 ||
+        listen(unixfd, SOMAXCONN) < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error listening on %s", UNIX_PATH);
+        if (unixfd >= 0) close(unixfd);
+        close(listenfd);
+        return 1;
+    }
+
+    gListenFd = listenfd;
+    gUnixListenFd = unixfd;
+    admissionConfig adm = admissionFor(gConfig);
+    gAdmission = newAdmission(&adm);
+
+    unsigned nworkers = std::thread::hardware_concurrency();
+    gPool = new WorkerPool(nworkers ? nworkers : 4);
 
-    gReactor = startReactor();
+    reactorOptions ropts;
+    ropts.cpu = REACTOR_CPU;
+    ropts.busy_poll_us = BUSY_POLL_US;
+    gReactor = startReactorOpts(&ropts);
     if(!gReactor) {
-        std::cerr << "Error starting reactor\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error starting reactor");
+        delete gPool;
+        freeAdmission(gAdmission);
         close(listenfd);
+        close(unixfd);
         return 1;
     }
 
+    addFdToReactor(gReactor, gPool->completionFd(), onWorkerDone);
     addFdToReactor(gReactor, listenfd, onAccept);
+    addFdToReactor(gReactor, unixfd, onAccept);
+    addFdToReactor(gReactor, sigfd, onSignal);
+
+    {
+        std::unique_lock<std::mutex> lock(gExitMtx);
+        while (!gDrainStarted) gExitCv.wait(lock);
+        // a stuck job must not hold the process forever
+        if (!gExitCv.wait_for(lock, std::chrono::milliseconds(DRAIN_TIMEOUT_MS),
+                              [] { return gDrained; })) {
+            logPrintf(LOG_LEVEL_WARN, "Drain timed out, closing remaining connections");
+        }
+    }
 
-    while(!gStopFlag) pause(); 
-
-    std::cout << "Shutting down reactor...\n";
+    logPrintf(LOG_LEVEL_INFO, "Shutting down reactor...");
     stopReactor(gReactor);
-    std::cout << "Reactor stopped\n";
+    delete gPool;
+    freeAdmission(gAdmission);
+    logPrintf(LOG_LEVEL_INFO, "Reactor stopped");
     close(listenfd);
+    close(unixfd);
+    unlink(UNIX_PATH);
+    close(sigfd);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+// Text-protocol commands and a dispatch table built at compile time.
+//
+// The first token of a command line is looked up with a perfect hash: the
+// seed is searched for at compile time so that every name below lands in
+// its own slot, and a lookup is one hash of the token, one table load and
+// one compare. No stream, no std::string.
+//
+// Adding a command: give it a Command value and a name in COMMAND_NAMES,
+// then register a handler for it in the servers that serve it. Commands a
+// server doesn't register go to its unknown-command handler.
+
+#include <array>
+#include <initializer_list>
+#include <string_view>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+enum Command : uint8_t {
+    CMD_UNKNOWN = 0,
+    CMD_NEWGRAPH,
+    CMD_CH,
+    CMD_NEWPOINT,
+    CMD_REMOVEPOINT,
+    CMD_ADDEDGE,
+    CMD_REMOVEEDGE,
+    CMD_SHMGRAPH,
+    CMD_BEGIN,
+    CMD_COMMIT,
+    CMD_WATCH,
+    CMD_UNWATCH,
+    CMD_SUBSCRIBE,
+    CMD_UNSUBSCRIBE,
+    CMD_USE,
+    CMD_COUNT
+};
+
+// indexed by Command
+inline constexpr std::string_view COMMAND_NAMES[CMD_COUNT] = {
+    "",
+    "Newgraph",
+    "CH",
+    "Newpoint",
+    "Removepoint",
+    "Addedge",
+    "Removeedge",
+    "Shmgraph",
+    "Begin",
+    "Commit",
+    "Watch",
+    "Unwatch",
+    "Subscribe",
+    "Unsubscribe",
+    "Use",
+};
+
+inline constexpr size_t COMMAND_SLOTS = 32;   // power of two, > CMD_COUNT; 2x leaves a seed easy to find
+static_assert((COMMAND_SLOTS & (COMMAND_SLOTS - 1)) == 0 && COMMAND_SLOTS > CMD_COUNT,
+              "grow COMMAND_SLOTS with the command list");
+
+// FNV-1a with a seed folded into the offset basis
+constexpr size_t commandSlot(std::string_view s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : s) h = (h ^ (unsigned char)c) * 16777619u;
+    return (h ^ (h >> 16)) & (COMMAND_SLOTS - 1);
+}
+
+constexpr bool commandSeedWorks(uint32_t seed) {
+    bool used[COMMAND_SLOTS] = {};
+    for (int c = 1; c < CMD_COUNT; ++c) {
+        size_t slot = commandSlot(COMMAND_NAMES[c], seed);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findCommandSeed() {
+    for (uint32_t seed = 0; seed < 100000; ++seed) {
+        if (commandSeedWorks(seed)) return seed;
+    }
+    return UINT32_MAX;
+}
+
+inline constexpr uint32_t COMMAND_SEED = findCommandSeed();
+static_assert(COMMAND_SEED != UINT32_MAX, "no collision-free seed; raise COMMAND_SLOTS");
+
+constexpr std::array<uint8_t, COMMAND_SLOTS> buildCommandSlots() {
+    std::array<uint8_t, COMMAND_SLOTS> slots{};   // empty slots hold CMD_UNKNOWN
+    for (int c = 1; c < CMD_COUNT; ++c) slots[commandSlot(COMMAND_NAMES[c], COMMAND_SEED)] = (uint8_t)c;
+    return slots;
+}
+
+inline constexpr std::array<uint8_t, COMMAND_SLOTS> COMMAND_SLOT_TABLE = buildCommandSlots();
+
+constexpr Command lookupCommand(std::string_view token) {
+    Command c = (Command)COMMAND_SLOT_TABLE[commandSlot(token, COMMAND_SEED)];
+    return COMMAND_NAMES[c] == token ? c : CMD_UNKNOWN;
+}
+
+static_assert(lookupCommand("Newgraph") == CMD_NEWGRAPH && lookupCommand("CH") == CMD_CH &&
+              lookupCommand("Ch") == CMD_UNKNOWN && lookupCommand("") == CMD_UNKNOWN,
+              "command table");
+
+constexpr bool isCommandSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// The first whitespace-separated token of line (what `in >> cmd` read);
+// args gets the rest.
+constexpr std::string_view splitCommand(std::string_view line, std::string_view& args) {
+    size_t i = 0;
+    while (i < line.size() && isCommandSpace(line[i])) ++i;
+    size_t start = i;
+    while (i < line.size() && !isCommandSpace(line[i])) ++i;
+    args = line.substr(i);
+    return line.substr(start, i - start);
+}
+
+// Handler per Command, for whatever handler signature a server uses.
+// Built as a constexpr table:
+//
+//     static constexpr CommandDispatch<Handler> COMMANDS{onUnknown, {
+//         {CMD_NEWGRAPH, onNewgraph},
+//         {CMD_CH, onCH},
+//     }};
+//     COMMANDS.find(token)(...);
+template <typename Handler>
+struct CommandDispatch {
+    std::array<Handler, CMD_COUNT> handlers{};
+
+    constexpr CommandDispatch(Handler unknown, std::initializer_list<std::pair<Command, Handler>> regs) {
+        for (int c = 0; c < CMD_COUNT; ++c) handlers[c] = unknown;
+        for (const std::pair<Command, Handler>& r : regs) handlers[r.first] = r.second;
+    }
+
+    constexpr Handler find(std::string_view token) const { return handlers[lookupCommand(token)]; }
+};
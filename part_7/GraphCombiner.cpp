@@ -0,0 +1,74 @@
+#include "GraphCombiner.hpp"
+#include <thread>
+
+static constexpr int COMBINE_PASSES = 4;   // re-check for late arrivals before unlocking
+static constexpr int SPINS_BEFORE_YIELD = 64;
+
+bool GraphCombiner::apply(Op op, const Point& a, const Point& b) {
+    switch (op) {
+    case ADD_POINT:    return graph_.addPoint(a);
+    case REMOVE_POINT: return graph_.removePoint(a);
+    case ADD_EDGE:     return graph_.addEdge(a, b);
+    case REMOVE_EDGE:  return graph_.removeEdge(a, b);
+    }
+    return false;
+}
+
+bool GraphCombiner::submit(Op op, const Point& a, const Point& b) {
+    // uncontended: no need to publish, but serve whoever did
+    if (mtx_.try_lock()) {
+        bool result = apply(op, a, b);
+        combine();
+        mtx_.unlock();
+        return result;
+    }
+
+    Request req;
+    req.op = op;
+    req.a = a;
+    req.b = b;
+    req.result = false;
+    req.done.store(false, std::memory_order_relaxed);
+    req.next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(req.next, &req, std::memory_order_release,
+                                        std::memory_order_relaxed)) {}
+
+    for (int spins = 0; ; ++spins) {
+        if (req.done.load(std::memory_order_acquire)) return req.result;
+        if (mtx_.try_lock()) {
+            combine();            // our request was published first, so it is in there
+            mtx_.unlock();
+            continue;
+        }
+        if (spins < SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            std::this_thread::yield();   // let the combiner run
+        }
+    }
+}
+
+void GraphCombiner::combine() {
+    for (int pass = 0; pass < COMBINE_PASSES; ++pass) {
+        if (!head_.load(std::memory_order_relaxed)) return;   // skip the RMW when idle
+        Request* list = head_.exchange(nullptr, std::memory_order_acquire);
+
+        // oldest first, so requests apply in the order they were published
+        Request* fifo = nullptr;
+        while (list) {
+            Request* next = list->next;
+            list->next = fifo;
+            fifo = list;
+            list = next;
+        }
+
+        while (fifo) {
+            Request* r = fifo;
+            fifo = r->next;       // r may be gone as soon as done is set
+            r->result = apply(r->op, r->a, r->b);
+            r->done.store(true, std::memory_order_release);
+        }
+    }
+}
@@ -1,31 +1,44 @@
 #include "Graph.hpp"
+#include "GraphCombiner.hpp"
+#include "LineReader.hpp"
+#include "CommandTable.hpp"
+#include "ReplyWriter.hpp"
 #include <iostream>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <string_view>
+#include <cstdlib>
+#include <cstring>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <sys/un.h>
 #include <unistd.h>
 #include <mutex>
 #include <thread>
 #include <signal.h>
 
 static constexpr int PORT = 9034;
+static constexpr const char* UNIX_PATH = "/tmp/graph_server.sock";
+static constexpr size_t MAX_TXN_OPS = 1 << 16;   // lines one Begin block may hold
 
 Graph graph;
 std::mutex graphMutex;
+static GraphCombiner gWriter(graph, graphMutex);   // Newpoint/Removepoint/Addedge/Removeedge
 
-bool recvLine(int fd, std::string& line) {
-    line.clear();
-    char c;
-    while (true) {
-        ssize_t n = recv(fd, &c, 1, 0);
-        if (n <= 0) return false; // Error or connection closed
-        if (c == '\n') break;
-        if (c != '\r') line.push_back(c);
-    }
-    return true; // Successfully received a line
+// "x,y" straight out of a reader line (which is NUL-terminated), no
+// stream; accepts what `in >> x >> comma >> y` did
+static bool parsePoint(std::string_view line, double& x, double& y) {
+    const char* p = line.data();
+    char* end;
+    x = strtod(p, &end);
+    if (end == p || !std::isfinite(x)) return false;
+    p = end;
+    while (*p == ' ' || *p == '	') ++p;
+    if (*p++ != ',') return false;
+    y = strtod(p, &end);
+    return end != p && std::isfinite(y);
 }
 
 void sendAll(int fd, const std::string& message) {
@@ -43,129 +56,303 @@ void sendAll(int fd, const std::string& message) {
 }
 
 
-void handleClient(int clientSocket) {
-    std::string line;
+// what a command handler works with, on the connection's own thread
+struct Session {
+    int fd;
+    LineReader& reader;
+    std::string out;              // reply being built, reused across requests
+};
 
-    while (recvLine(clientSocket, line)) {
-        if (line.empty()) continue;
-        std::istringstream in(line);
-        std::string cmd;
-        in >> cmd;
-
-        if (cmd == "Newgraph") {
-            int n; in >> n;
-            std::vector<Point> pts;
-            bool readOk = true;
-
-            for (int i = 0; i < n; ++i) {
-                if (!recvLine(clientSocket, line)){
-                    readOk = false;
-                    break;
-                } 
-                if (line.empty()) { i--; continue; }
-                double x, y; char comma;
-                std::istringstream ptin(line);
-                if (!(ptin >> x >> comma >> y) || comma != ',') {
-                    std::ostringstream err;
-                    err << "Invalid point format: " << line << "\n";
-                    readOk = false;
-                    sendAll(clientSocket, err.str());
-                    break;
-                }
-                pts.emplace_back(Point{x,y});
-            }
-            if(readOk){
-                std::lock_guard<std::mutex> lock(graphMutex);
-                graph.newGraph(pts);
-                sendAll(clientSocket, "New graph created\n");
-            }
-            continue;
+// one per command; false ends the connection. args is what follows the name.
+typedef bool (*CommandHandler)(Session& s, std::string_view args);
 
-        } else if (cmd == "CH") {
-            double area;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                area = graph.area();
-            }
-            std::ostringstream out;
-            out << "Area = " << area << std::endl;
-            sendAll(clientSocket, out.str());
-
-        } else if (cmd == "Newpoint") {
-            double x, y; char comma;
-            in >> x >> comma >> y;
-            if (comma != ',') {
-                sendAll(clientSocket, "Invalid point format\n");
-                continue;
-            }
+static bool onNewgraph(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    int n; in >> n;
+    std::vector<Point> pts;
+    std::string_view line;
+    bool readOk = true;
 
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.addPoint(Point{x, y})) {
-                    sendAll(clientSocket, "Failed to add point (duplicate)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Point added: " << x << "," << y << "\n";
-            sendAll(clientSocket, response.str());
-
-        } else if (cmd == "Removepoint") {
-            double x, y; char comma;
-            in >> x >> comma >> y;
-            if (comma != ',') {
-                sendAll(clientSocket, "Invalid point format\n");
-                continue;
-            }
+    for (int i = 0; i < n; ++i) {
+        if (!s.reader.readLine(line)){
+            readOk = false;
+            break;
+        } 
+        if (line.empty()) { i--; continue; }
+        double x, y;
+        if (!parsePoint(line, x, y)) {
+            s.out.clear();
+            ReplyWriter(s.out) << "Invalid point format: " << line << "\n";
+            readOk = false;
+            sendAll(s.fd, s.out);
+            break;
+        }
+        pts.emplace_back(Point{x,y});
+    }
+    if(readOk){
+        std::lock_guard<std::mutex> lock(graphMutex);
+        graph.newGraph(pts);
+        sendAll(s.fd, "New graph created\n");
+    }
+    return true;
+}
 
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.removePoint(Point{x, y})) {
-                    sendAll(clientSocket, "Failed to remove point (not found)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Point removed: " << x << "," << y << "\n";
-            sendAll(clientSocket, response.str());
-            
-
-        } else if (cmd == "Addedge") {
-            double x1, y1, x2, y2; char comma1, comma2;
-            in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.addEdge(Point{x1, y1}, Point{x2, y2})) {
-                    sendAll(clientSocket, "Failed to add edge (duplicate)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Edge added: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
-            sendAll(clientSocket, response.str());
-
-        } else if (cmd == "Removeedge") {
-            double x1, y1, x2, y2; char comma1, comma2;
-            in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.removeEdge(Point{x1, y1}, Point{x2, y2})) {
-                    sendAll(clientSocket, "Failed to remove edge (not found)\n");
-                    continue;
-                }
+static bool onCH(Session& s, std::string_view) {
+    double area;
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        area = graph.area();
+    }
+    s.out.clear();
+    ReplyWriter(s.out) << "Area = " << area << "\n";
+    sendAll(s.fd, s.out);
+    return true;
+}
+
+static bool onNewpoint(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        sendAll(s.fd, "Invalid point format\n");
+        return true;
+    }
+
+    if (!gWriter.addPoint(Point{x, y})) {
+        sendAll(s.fd, "Failed to add point (duplicate)\n");
+        return true;
+    }
+    s.out.clear();
+    ReplyWriter(s.out) << "Point added: " << x << "," << y << "\n";
+    sendAll(s.fd, s.out);
+    return true;
+}
+
+static bool onRemovepoint(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        sendAll(s.fd, "Invalid point format\n");
+        return true;
+    }
+
+    if (!gWriter.removePoint(Point{x, y})) {
+        sendAll(s.fd, "Failed to remove point (not found)\n");
+        return true;
+    }
+    s.out.clear();
+    ReplyWriter(s.out) << "Point removed: " << x << "," << y << "\n";
+    sendAll(s.fd, s.out);
+    return true;
+}
+
+static bool onAddedge(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char comma1, comma2;
+    in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+    if (!gWriter.addEdge(Point{x1, y1}, Point{x2, y2})) {
+        sendAll(s.fd, "Failed to add edge (duplicate)\n");
+        return true;
+    }
+    s.out.clear();
+    ReplyWriter(s.out) << "Edge added: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
+    sendAll(s.fd, s.out);
+    return true;
+}
+
+static bool onRemoveedge(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char comma1, comma2;
+    in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+    if (!gWriter.removeEdge(Point{x1, y1}, Point{x2, y2})) {
+        sendAll(s.fd, "Failed to remove edge (not found)\n");
+        return true;
+    }
+    s.out.clear();
+    ReplyWriter(s.out) << "Edge removed: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
+    sendAll(s.fd, s.out);
+    return true;
+}
+
+// one line of a Begin/Commit block, parsed before anything is applied
+struct TxnOp {
+    Command cmd;
+    Point a, b;
+    const char* error;   // set if the line can't go into a transaction
+    bool ok;
+    double area;
+};
+
+static const char* parseTxnOp(TxnOp& op, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    char c1, c2;
+    switch (op.cmd) {
+    case CMD_NEWPOINT:
+    case CMD_REMOVEPOINT:
+        if (!(in >> op.a.x >> c1 >> op.a.y) || c1 != ',') return "Invalid point format\n";
+        return nullptr;
+    case CMD_ADDEDGE:
+    case CMD_REMOVEEDGE:
+        if (!(in >> op.a.x >> c1 >> op.a.y >> op.b.x >> c2 >> op.b.y) || c1 != ',' || c2 != ',')
+            return "Invalid edge format\n";
+        return nullptr;
+    case CMD_CH:
+        return nullptr;
+    case CMD_NEWGRAPH:
+        return "Newgraph is not allowed in a transaction\n";
+    case CMD_BEGIN:
+        return "Transaction already in progress\n";
+    default:
+        return "Unknown command\n";
+    }
+}
+
+// Begin: the lines up to Commit are parsed first, then applied under one
+// graphMutex acquisition, so no other client sees the block half done.
+// Each line gets its usual reply, all sent together and followed by
+// "Committed". If any line doesn't parse, nothing is applied: that line
+// gets its error, the others "Not applied", and the block ends "Aborted".
+// A block longer than MAX_TXN_OPS is aborted as soon as it gets there and
+// the connection closed: the rest of it can be neither kept nor run alone.
+static bool onBegin(Session& s, std::string_view) {
+    std::vector<TxnOp> ops;
+    bool valid = true;
+    std::string_view line;
+    for (;;) {
+        if (!s.reader.readLine(line)) return false;   // gone mid-block: nothing applied
+        if (line.empty()) continue;
+        std::string_view args;
+        Command cmd = lookupCommand(splitCommand(line, args));
+        if (cmd == CMD_COMMIT) break;
+        if (ops.size() == MAX_TXN_OPS) {
+            sendAll(s.fd, "Transaction too large\nAborted\n");
+            return false;
+        }
+        TxnOp op{cmd, Point{0, 0}, Point{0, 0}, nullptr, false, 0};
+        op.error = parseTxnOp(op, args);
+        if (op.error) valid = false;
+        ops.push_back(op);
+    }
+
+    s.out.clear();
+    ReplyWriter out(s.out);
+    if (!valid) {
+        for (const TxnOp& op : ops) out << (op.error ? op.error : "Not applied\n");
+        out << "Aborted\n";
+    sendAll(s.fd, s.out);
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        for (TxnOp& op : ops) {
+            switch (op.cmd) {
+            case CMD_NEWPOINT:    op.ok = graph.addPoint(op.a); break;
+            case CMD_REMOVEPOINT: op.ok = graph.removePoint(op.a); break;
+            case CMD_ADDEDGE:     op.ok = graph.addEdge(op.a, op.b); break;
+            case CMD_REMOVEEDGE:  op.ok = graph.removeEdge(op.a, op.b); break;
+            case CMD_CH:          op.area = graph.area(); break;
+            default: break;
             }
-            std::ostringstream response;
-            response << "Edge removed: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
-            sendAll(clientSocket, response.str());
+        }
+    }
 
-        } else {
-            sendAll(clientSocket, "Unknown command\n");
+    for (const TxnOp& op : ops) {
+        switch (op.cmd) {
+        case CMD_NEWPOINT:
+            if (op.ok) out << "Point added: " << op.a.x << "," << op.a.y << "\n";
+            else out << "Failed to add point (duplicate)\n";
+            break;
+        case CMD_REMOVEPOINT:
+            if (op.ok) out << "Point removed: " << op.a.x << "," << op.a.y << "\n";
+            else out << "Failed to remove point (not found)\n";
+            break;
+        case CMD_ADDEDGE:
+            if (op.ok) out << "Edge added: (" << op.a.x << "," << op.a.y << ") - (" << op.b.x << "," << op.b.y << ")\n";
+            else out << "Failed to add edge (duplicate)\n";
+            break;
+        case CMD_REMOVEEDGE:
+            if (op.ok) out << "Edge removed: (" << op.a.x << "," << op.a.y << ") - (" << op.b.x << "," << op.b.y << ")\n";
+            else out << "Failed to remove edge (not found)\n";
+            break;
+        case CMD_CH:
+            out << "Area = " << op.area << "\n";
+            break;
+        default:
             break;
         }
     }
+    out << "Committed\n";
+    sendAll(s.fd, s.out);
+    return true;
+}
+
+static bool onCommit(Session& s, std::string_view) {
+    sendAll(s.fd, "No transaction in progress\n");
+    return true;
+}
+
+static bool onUnknown(Session& s, std::string_view) {
+    sendAll(s.fd, "Unknown command\n");
+    return false;
+}
+
+static constexpr CommandDispatch<CommandHandler> COMMANDS{onUnknown, {
+    {CMD_NEWGRAPH, onNewgraph},
+    {CMD_CH, onCH},
+    {CMD_NEWPOINT, onNewpoint},
+    {CMD_REMOVEPOINT, onRemovepoint},
+    {CMD_ADDEDGE, onAddedge},
+    {CMD_REMOVEEDGE, onRemoveedge},
+    {CMD_BEGIN, onBegin},
+    {CMD_COMMIT, onCommit},
+}};
+
+void handleClient(int clientSocket) {
+    LineReader reader(clientSocket);
+    Session s{clientSocket, reader, {}};
+    std::string_view line;
+
+    while (reader.readLine(line)) {
+        if (line.empty()) continue;
+        std::string_view args;
+        std::string_view cmd = splitCommand(line, args);
+        if (!COMMANDS.find(cmd)(s, args)) break;
+    }
     close(clientSocket);
 }
 
+// Unix socket for clients on this host: same protocol, no TCP stack.
+// A socket file left over from a previous run is replaced.
+static int listenUnix(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// a thread per client, as they come
+static void acceptLoop(int listenfd) {
+    while(true) {
+        int clientSocket = accept(listenfd, nullptr, nullptr);
+        if (clientSocket < 0) {
+            std::cerr << "Error accepting connection\n";
+            continue;
+        }
+        
+        std::thread t(handleClient, clientSocket);
+        t.detach(); // Detach the thread to handle the client independently
+    }
+}
+
 int main() {
     signal(SIGPIPE, SIG_IGN);
 
@@ -195,17 +382,16 @@ int main() {
         close(listenfd);
         return 1;
     }
-    
-    while(true) {
-        int clientSocket = accept(listenfd, nullptr, nullptr);
-        if (clientSocket < 0) {
-            std::cerr << "Error accepting connection\n";
-            continue;
-        }
-        
-        std::thread t(handleClient, clientSocket);
-        t.detach(); // Detach the thread to handle the client independently
+
+    int unixfd = listenUnix(UNIX_PATH);
+    if (unixfd < 0) {
+        std::cerr << "Error listening on " << UNIX_PATH << "\n";
+        close(listenfd);
+        return 1;
     }
+    std::thread(acceptLoop, unixfd).detach();
+
+    acceptLoop(listenfd);
 
     close(listenfd);
     return 0;
@@ -0,0 +1,103 @@
+#include "reactor.hpp"
+#include <new>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <time.h>
+#include <netinet/in.h>
+
+// ----- connection admission -----
+// A global cap on open connections plus a token bucket per source
+// address. Shared by the reactor accept callback and the proactor accept
+// thread, released from whatever thread closes the connection.
+
+struct admission {
+    struct Bucket { double tokens; double last; };
+
+    admissionConfig cfg;
+    std::mutex mtx;
+    int open;
+    std::unordered_map<std::string, Bucket> buckets;
+
+    admission() : cfg(), open(0) {}
+};
+
+static const size_t MAX_BUCKETS = 4096;   // prune idle sources beyond this
+
+static double nowSec() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// address bytes only; the port changes on every connect
+static std::string sourceKey(const struct sockaddr* peer) {
+    if (!peer) return std::string();
+    if (peer->sa_family == AF_INET) {
+        const sockaddr_in* in = reinterpret_cast<const sockaddr_in*>(peer);
+        return std::string(reinterpret_cast<const char*>(&in->sin_addr), sizeof(in->sin_addr));
+    }
+    if (peer->sa_family == AF_INET6) {
+        const sockaddr_in6* in6 = reinterpret_cast<const sockaddr_in6*>(peer);
+        return std::string(reinterpret_cast<const char*>(&in6->sin6_addr), sizeof(in6->sin6_addr));
+    }
+    return std::string();   // e.g. AF_UNIX: all local peers share one bucket
+}
+
+void* newAdmission(const admissionConfig* cfg) {
+    admission* A = new (std::nothrow) admission();
+    if (!A) return NULL;
+    if (cfg) A->cfg = *cfg;
+    if (A->cfg.burst <= 0) A->cfg.burst = 1;
+    return A;
+}
+
+int admitConnection(void* ap, const struct sockaddr* peer) {
+    if (!ap) return 1;
+    admission* A = static_cast<admission*>(ap);
+    std::lock_guard<std::mutex> lock(A->mtx);
+
+    if (A->cfg.max_conns > 0 && A->open >= A->cfg.max_conns) return 0;
+
+    if (A->cfg.rate_per_sec > 0) {
+        double now = nowSec();
+        if (A->buckets.size() > MAX_BUCKETS) {
+            // forget sources whose bucket has refilled anyway
+            for (auto it = A->buckets.begin(); it != A->buckets.end(); ) {
+                if (it->second.tokens + (now - it->second.last) * A->cfg.rate_per_sec >= A->cfg.burst)
+                    it = A->buckets.erase(it);
+                else
+                    ++it;
+            }
+        }
+        auto ins = A->buckets.emplace(sourceKey(peer), admission::Bucket{(double)A->cfg.burst, now});
+        admission::Bucket& b = ins.first->second;
+        b.tokens += (now - b.last) * A->cfg.rate_per_sec;
+        if (b.tokens > A->cfg.burst) b.tokens = A->cfg.burst;
+        b.last = now;
+        if (b.tokens < 1.0) return 0;
+        b.tokens -= 1.0;
+    }
+
+    ++A->open;
+    return 1;
+}
+
+void releaseConnection(void* ap) {
+    if (!ap) return;
+    admission* A = static_cast<admission*>(ap);
+    std::lock_guard<std::mutex> lock(A->mtx);
+    if (A->open > 0) --A->open;
+}
+
+void updateAdmission(void* ap, const admissionConfig* cfg) {
+    if (!ap || !cfg) return;
+    admission* A = static_cast<admission*>(ap);
+    std::lock_guard<std::mutex> lock(A->mtx);
+    A->cfg = *cfg;
+    if (A->cfg.burst <= 0) A->cfg.burst = 1;
+}
+
+void freeAdmission(void* ap) {
+    delete static_cast<admission*>(ap);
+}
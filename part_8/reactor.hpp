@@ -1,5 +1,6 @@
 #pragma once
 #include <pthread.h>
+#include <stddef.h>
 
 
 typedef void* (*reactorFunc)(int fd);
@@ -8,14 +9,155 @@ typedef struct reactor reactor;
 
 void *startReactor ();
 
+// Options for latency-critical deployments; startReactor() uses defaults
+// (no pinning, no spinning).
+typedef struct reactorOptions {
+    int cpu;              // pin the loop thread to this CPU, -1 = don't pin
+    int busy_poll_us;     // max busy-poll window before blocking, 0 = off
+} reactorOptions;
+
+void *startReactorOpts(const reactorOptions *opts);
+
+// SO_BUSY_POLL on a client socket: the kernel polls the device queue for
+// up to usec on a blocking read instead of waiting for the interrupt.
+// Values above net.core.busy_read need CAP_NET_ADMIN; returns -1 if refused.
+int setBusyPoll(int fd, int usec);
+
 int addFdToReactor(void *reactor, int fd, reactorFunc func);
 
+// Same as addFdToReactor, but ctx is handed back on every dispatch so the
+// callback can reach its per-fd state without a lookup. The reactor never
+// touches ctx; it stays owned by the caller.
+typedef void* (*reactorCtxFunc)(int fd, void *ctx);
+
+int addFdToReactorCtx(void *reactor, int fd, reactorCtxFunc func, void *ctx);
+
 int removeFdFromReactor(void *reactor, int fd);
 
+// What a registered fd is dispatched on. Registration starts it at
+// REACTOR_READ; add REACTOR_WRITE while output waits for socket space, or
+// pass 0 to keep the registration but hear nothing more about the fd. The
+// callback stays the same one, so it finds out which it can do by trying
+// (the fd should be nonblocking).
+enum { REACTOR_READ = 1, REACTOR_WRITE = 2 };
+
+int setFdEvents(void *reactor, int fd, int events);
+
 int stopReactor(void *reactor);
 
+// The reactor whose loop is running on the calling thread (so, from inside
+// one of its callbacks), NULL on any other thread.
+void *currentReactor(void);
+
+// Signals as reactor events. openSignalFd blocks the given signals in the
+// calling thread and returns a nonblocking signalfd for them (-1 on error);
+// call it before any other thread starts so they inherit the mask, then
+// register the fd like any other. readSignal returns the next pending
+// signal number, 0 when none is left, -1 on error.
+int openSignalFd(const int *signals, int n);
+
+int readSignal(int sigfd);
+
+// Connection admission: a cap on open connections and a token bucket per
+// source address. Zero fields mean "no limit".
+struct sockaddr;
+
+typedef struct admissionConfig {
+    int    max_conns;       // connections admitted and not yet released
+    double rate_per_sec;    // new connections per second from one address
+    int    burst;           // connections one address may open back to back
+} admissionConfig;
+
+void *newAdmission(const admissionConfig *cfg);
+
+// 1: admitted (counts against max_conns until releaseConnection), 0: shed
+int admitConnection(void *admission, const struct sockaddr *peer);
+
+void releaseConnection(void *admission);
+
+// New limits for connections admitted from now on; already open ones stay.
+void updateAdmission(void *admission, const admissionConfig *cfg);
+
+void freeAdmission(void *admission);
+
+// Asynchronous logging. logPrintf() formats into a lock-free ring and
+// returns; a flusher thread adds a timestamp and the level and writes the
+// lines in batches, DEBUG/INFO to stdout and WARN/ERROR to stderr. Before
+// startLogger() and after stopLogger() lines are written synchronously. A
+// full ring drops messages and the flusher reports how many.
+typedef enum logLevel {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+} logLevel;
+
+int startLogger(logLevel minLevel);
+
+void logPrintf(logLevel level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Writes out what is queued and joins the flusher.
+void stopLogger(void);
+
 typedef void* (*proactorFunc) (int sockfd);
 
 pthread_t startProactor(int sockfd, proactorFunc threadfunc);
 
-int stopProactor(pthread_t tid);
\ No newline at end of file
+// Thread-per-client like startProactor, with admission control in front
+// of it. The listener is switched to nonblocking so each wakeup accepts
+// the whole backlog.
+pthread_t startProactorLimited(int sockfd, proactorFunc threadfunc, const admissionConfig *adm);
+
+int stopProactor(pthread_t tid);
+
+// Pooled mode: a fixed set of workers serves connections as they become
+// ready instead of one detached thread per client. A poller thread accepts
+// and keeps idle connections in epoll; when one has input, a worker runs
+// one turn of the handler on it:
+//
+//     int func(int sockfd, void **conn);
+//
+// The handler serves what the client has sent and returns nonzero to hand
+// the connection back (the pool watches it for the next input), or 0 once
+// the client is done, after which the pool closes sockfd. *conn is the
+// handler's per-connection state, NULL on the first turn, to be freed
+// before returning 0. The socket is left blocking: a turn may wait inside
+// a command, but should go back to the pool rather than wait for the next
+// one, so that idle clients hold no worker. Zero fields pick the defaults
+// (16 workers, system stack size, 1024 connections, no rate limit).
+typedef int (*poolFunc)(int sockfd, void **conn);
+
+typedef struct proactorConfig {
+    int    workers;       // threads running turns of func
+    size_t stack_size;    // bytes per worker stack, 0 = system default
+    int    max_conns;     // open connections; beyond are told "Server busy" and closed
+    double rate_per_sec;  // new connections per second from one address
+    int    burst;         // connections one address may open back to back
+} proactorConfig;
+
+void *startProactorPool(int sockfd, poolFunc func, const proactorConfig *cfg);
+
+// Another listening socket whose connections the pool serves like the
+// first one's (a Unix socket next to TCP, say), sharing its workers and
+// max_conns. The caller keeps closing the fd, after stopProactorPool.
+int addPoolListener(void *pool, int sockfd);
+
+// Stops accepting, shuts down the read side of every connection and lets
+// each handler run until it returns 0, then joins every worker.
+int stopProactorPool(void *pool);
+
+// Work-stealing executor: each worker keeps its own deque and idle
+// workers steal from the others. Any thread may submit.
+typedef void (*taskFunc)(void *arg);
+
+void *startExecutor(int nworkers);          // nworkers <= 0: one per core
+
+int submitTask(void *executor, taskFunc func, void *arg);
+
+// Runs func(args[i]) for i in [0, n) on the executor and returns when all
+// of them have finished. Called from a worker, it keeps running tasks
+// while it waits instead of blocking.
+int runTasks(void *executor, taskFunc func, void **args, int n);
+
+// Finishes every task already submitted, then joins the workers.
+int stopExecutor(void *executor);
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 void Graph::newGraph(const std::vector<Point>& points) {
     points_ = points;
+    ++version_;
 }
 
 bool Graph::addPoint(const Point& p) {
@@ -11,6 +12,7 @@ bool Graph::addPoint(const Point& p) {
         return false;
     }
     points_.push_back(p);
+    ++version_;
     return true;
 }
 
@@ -20,6 +22,7 @@ bool Graph::removePoint(const Point& p) {
         return false;
     }
     points_.erase(it, points_.end());
+    ++version_;
     return true;
 }
 
@@ -34,6 +37,7 @@ bool Graph::addEdge(const Point& p1, const Point& p2) {
     if (std::find(edges_.begin(), edges_.end(), e) == edges_.end()) {
         edges_.push_back(e);
     }
+    ++version_;
     return true;
 }
 
@@ -46,6 +50,7 @@ bool Graph::removeEdge(const Point& p1, const Point& p2) {
     }
     auto e = std::make_pair(p1, p2);
     edges_.erase(std::remove(edges_.begin(), edges_.end(), e), edges_.end());
+    ++version_;
     return true;
 }
 
@@ -58,7 +63,7 @@ double Graph::area() const {
     auto hull = convexHull();
     return ComputeArea(hull);
 }
-std::vector<Point> Graph::ComputeConvexHull(std::vector<Point>& pts) const {
+std::vector<Point> Graph::ComputeConvexHull(std::vector<Point>& pts) {
     sort(pts.begin(), pts.end());           // uses Point::operator<
     int n = pts.size(), k = 0;
     if (n <= 1) return pts;
@@ -82,7 +87,7 @@ std::vector<Point> Graph::ComputeConvexHull(std::vector<Point>& pts) const {
     return H;
 }
 
-double Graph::ComputeArea(const std::vector<Point>& P) const {
+double Graph::ComputeArea(const std::vector<Point>& P) {
     double area = 0;
     int m = P.size();
     for (int i = 0; i < m; ++i) {
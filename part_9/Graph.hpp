@@ -2,6 +2,7 @@
 
 #include "Point.hpp"
 #include <vector>
+#include <stdint.h>
 
 
 class Graph {
@@ -21,11 +22,18 @@ public:
     const std::vector<Point>& getPoints() const { return points_; }
     const std::vector<std::pair<Point, Point>>& getEdges() const { return edges_; }
 
+    // bumped by every change, so a result computed for one version can be
+    // reused until the next
+    uint64_t version() const { return version_; }
+
+    // Building blocks for callers that split the hull work themselves.
+    static std::vector<Point> ComputeConvexHull(std::vector<Point>& pts);
+    static double ComputeArea(const std::vector<Point>& P);
+
 private:
     std::vector<Point> points_;
     std::vector<std::pair<Point, Point>> edges_;
-    std::vector<Point> ComputeConvexHull(std::vector<Point>& pts) const;
-    double ComputeArea(const std::vector<Point>& P) const;
+    uint64_t version_ = 0;
     bool hasPoint(const Point& p) const;
 
 };
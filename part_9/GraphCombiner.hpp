@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Graph.hpp"
+#include <atomic>
+#include <mutex>
+
+
+// Flat-combining front end for the point and edge mutations of a shared
+// Graph. A caller publishes its request on a lock-free list and then
+// either finds it already applied or takes the mutex and applies every
+// request that has piled up, its own included, in one critical section.
+// Under contention one thread does a batch of mutations per lock handoff
+// instead of every thread paying for its own handoff.
+//
+// Anything else that touches the graph (CH, Newgraph, snapshots) keeps
+// taking the same mutex directly, so it always sees whole batches.
+class GraphCombiner {
+public:
+    GraphCombiner(Graph& graph, std::mutex& mtx) : graph_(graph), mtx_(mtx), head_(nullptr) {}
+
+    bool addPoint(const Point& p) { return submit(ADD_POINT, p, p); }
+    bool removePoint(const Point& p) { return submit(REMOVE_POINT, p, p); }
+    bool addEdge(const Point& p1, const Point& p2) { return submit(ADD_EDGE, p1, p2); }
+    bool removeEdge(const Point& p1, const Point& p2) { return submit(REMOVE_EDGE, p1, p2); }
+
+private:
+    enum Op { ADD_POINT, REMOVE_POINT, ADD_EDGE, REMOVE_EDGE };
+
+    // lives on the submitting thread's stack until done is set
+    struct Request {
+        Op op;
+        Point a, b;
+        bool result;
+        std::atomic<bool> done;
+        Request* next;
+    };
+
+    bool apply(Op op, const Point& a, const Point& b);   // mtx_ held
+    bool submit(Op op, const Point& a, const Point& b);
+    void combine();   // mtx_ held
+
+    Graph& graph_;
+    std::mutex& mtx_;
+    std::atomic<Request*> head_;   // published, not yet applied; newest first
+};
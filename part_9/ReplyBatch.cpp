@@ -0,0 +1,20 @@
+#include "ReplyBatch.hpp"
+#include <errno.h>
+#include <unistd.h>
+
+bool ReplyBatch::flush() {
+    const char* p = buf_.data();
+    size_t left = buf_.size();
+    while (left > 0) {
+        ssize_t n = write(fd_, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            buf_.clear();
+            return false;
+        }
+        p += n;
+        left -= n;
+    }
+    buf_.clear();   // keeps the capacity
+    return true;
+}
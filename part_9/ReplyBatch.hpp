@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+
+// Replies produced while working through one read batch. They pile up in
+// one buffer and go out together once the batch is used up, so a client
+// that pipelines K requests gets its K replies in one segment instead of
+// K sends. The buffer is kept across flushes; handlers format straight
+// into it (see ReplyWriter) and stop allocating once it has grown.
+class ReplyBatch {
+public:
+    explicit ReplyBatch(int fd) : fd_(fd) {}
+
+    void add(std::string_view reply) { buf_.append(reply.data(), reply.size()); }
+
+    std::string& buffer() { return buf_; }
+
+    // Sends everything queued; false once the peer is gone.
+    bool flush();
+
+private:
+    int fd_;
+    std::string buf_;
+};
@@ -0,0 +1,186 @@
+#include "coro.hpp"
+#include "reactor.hpp"
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <errno.h>
+
+// ----- coroutine connections -----
+// Everything here runs on the reactor thread, so no locking, and the
+// connection table is per thread: each reactor has its own loop thread,
+// so this gives every reactor a table of its own.
+
+static constexpr size_t MAX_LINE = 1 << 20;   // a line still without '\n' past this ends the input
+
+struct coConn {
+    void* reactor;
+    std::string inbuf;                 // received; lines before start are handed out
+    size_t start = 0;                  // first byte not yet returned as a line
+    size_t scanned = 0;                // [start, scanned) is known to hold no '\n'
+    bool eof = false;
+    std::coroutine_handle<> reader;    // suspended in readLine, if any
+    writeAwaiter* writer = nullptr;    // suspended in writeAll, if any
+};
+
+static thread_local std::vector<coConn*> tCoConns;  // indexed by fd, for readLine(fd)
+
+static coConn* connFor(int fd) {
+    if (fd < 0 || (size_t)fd >= tCoConns.size()) return nullptr;
+    return tCoConns[fd];
+}
+
+static bool hasLine(coConn* c) {
+    std::string::size_type pos = c->inbuf.find('\n', c->scanned);
+    if (pos != std::string::npos) return true;
+    c->scanned = c->inbuf.size();
+    return false;
+}
+
+// copy one complete line out of the buffer, if there is one; the bytes stay
+// where they are until onCoReadable makes room
+static bool takeLine(coConn* c, std::optional<std::string>& out) {
+    std::string::size_type pos = c->inbuf.find('\n', c->scanned);
+    if (pos == std::string::npos) {
+        c->scanned = c->inbuf.size();
+        return false;
+    }
+    size_t len = pos - c->start;
+    if (len > 0 && c->inbuf[pos - 1] == '\r') --len;
+    out.emplace(c->inbuf, c->start, len);
+    c->start = c->scanned = pos + 1;
+    return true;
+}
+
+// as much of w.buf as the socket takes; true once all of it went out or the
+// connection failed (w.ok tells which)
+static bool sendMore(writeAwaiter& w) {
+    while (w.sent < w.buf.size()) {
+        ssize_t n = send(w.fd, w.buf.data() + w.sent, w.buf.size() - w.sent, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+            w.ok = false;
+            return true;
+        }
+        w.sent += n;
+    }
+    w.ok = true;
+    return true;
+}
+
+static void* onCoReadable(int fd, void* ctx) {
+    coConn* c = static_cast<coConn*>(ctx);
+
+    // a handler waiting for send space reads nothing meanwhile, so only
+    // EPOLLOUT is armed and this is about the write
+    if (c->writer) {
+        writeAwaiter* w = c->writer;
+        if (!sendMore(*w)) return nullptr;
+        c->writer = nullptr;
+        setFdEvents(c->reactor, fd, c->eof ? 0 : REACTOR_READ);
+        w->waiting.resume();                   // may end in coClose(fd): don't touch c after
+        return nullptr;
+    }
+
+    // drop what was handed out before reading more, moving the partial
+    // line down only once it sits past the middle, so each byte moves O(1) times
+    if (c->start == c->inbuf.size()) {
+        c->inbuf.clear();
+        c->start = c->scanned = 0;
+    } else if (c->start > c->inbuf.size() / 2) {
+        c->inbuf.erase(0, c->start);
+        c->scanned -= c->start;
+        c->start = 0;
+    }
+
+    char buf[4096];
+    ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+        c->inbuf.append(buf, n);
+        if (!hasLine(c) && c->inbuf.size() - c->start > MAX_LINE) {
+            c->eof = true;                     // the handler sees EOF and closes
+            setFdEvents(c->reactor, fd, 0);
+        }
+    } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        c->eof = true;
+        setFdEvents(c->reactor, fd, 0);        // nothing more to read; coClose unregisters
+    } else {
+        return nullptr;
+    }
+
+    if (c->reader && (c->eof || hasLine(c))) {
+        std::coroutine_handle<> h = c->reader;
+        c->reader = nullptr;
+        h.resume();                            // may end in coClose(fd): don't touch c after
+    }
+    return nullptr;
+}
+
+int coSpawn(void* reactor, int fd, coHandler handler) {
+    if (!reactor || fd < 0 || !handler) return -1;
+    if (currentReactor() != reactor) return -1;   // fd would land in another thread's table
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) return -1;
+    if ((size_t)fd >= tCoConns.size()) tCoConns.resize((size_t)fd + 1, nullptr);
+    delete tCoConns[fd];                       // leftover from a handler that never closed
+    coConn* c = new coConn();
+    c->reactor = reactor;
+    tCoConns[fd] = c;
+
+    if (addFdToReactorCtx(reactor, fd, onCoReadable, c) < 0) {
+        tCoConns[fd] = nullptr;
+        delete c;
+        return -1;
+    }
+    handler(fd);                               // runs until its first real wait
+    return 0;
+}
+
+void coClose(int fd) {
+    coConn* c = connFor(fd);
+    if (c) {
+        removeFdFromReactor(c->reactor, fd);
+        tCoConns[fd] = nullptr;
+        delete c;
+    }
+    close(fd);
+}
+
+// a line, or EOF; false means the caller has to wait for more input
+static bool fillLine(int fd, std::optional<std::string>& line) {
+    coConn* c = connFor(fd);
+    if (!c) return true;                       // unknown fd: behave like EOF
+    if (takeLine(c, line)) return true;
+    return c->eof;                             // a trailing partial line is dropped
+}
+
+bool lineAwaiter::await_ready() {
+    done = fillLine(fd, line);
+    return done;
+}
+
+void lineAwaiter::await_suspend(std::coroutine_handle<> h) {
+    connFor(fd)->reader = h;
+}
+
+std::optional<std::string> lineAwaiter::await_resume() {
+    if (!done) fillLine(fd, line);             // woken by onCoReadable
+    return std::move(line);
+}
+
+bool writeAwaiter::await_ready() {
+    return sendMore(*this);
+}
+
+bool writeAwaiter::await_suspend(std::coroutine_handle<> h) {
+    coConn* c = connFor(fd);
+    if (!c) {                                  // not ours to wait on: give up
+        ok = false;
+        return false;
+    }
+    waiting = h;
+    c->writer = this;
+    setFdEvents(c->reactor, fd, REACTOR_WRITE);
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+// C++20 coroutine handlers on top of the reactor.
+//
+// A handler is written in the sequential style of a thread-per-client
+// handler, but every connection runs on the reactor thread:
+//
+//     coTask handle(int fd) {
+//         while (auto line = co_await readLine(fd)) {
+//             co_await writeAll(fd, reply(*line));
+//         }
+//         coClose(fd);
+//     }
+//
+// coSpawn() switches the fd to nonblocking, registers it with the reactor
+// and starts the handler; it must be called on the reactor thread (e.g.
+// from the accept callback) and fails anywhere else. Connections are
+// tracked per reactor, so several reactors can each run handlers; an fd
+// is only known to the reactor it was spawned on.
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+
+// Fire-and-forget coroutine: starts eagerly, frees itself when it returns.
+struct coTask {
+    struct promise_type {
+        coTask get_return_object() { return coTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+typedef coTask (*coHandler)(int fd);
+
+int coSpawn(void *reactor, int fd, coHandler handler);
+
+// Unregisters fd, drops its buffered input and closes it. A handler must
+// call this before it returns.
+void coClose(int fd);
+
+// Resumes with the next line (without '\n' / '\r'), or std::nullopt once
+// the peer has closed the connection and no full line is left. A line over
+// 1 MiB counts as the peer closing.
+struct lineAwaiter {
+    int fd;
+    bool done;
+    std::optional<std::string> line;
+
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> h);
+    std::optional<std::string> await_resume();
+};
+
+inline lineAwaiter readLine(int fd) { return lineAwaiter{fd, false, std::nullopt}; }
+
+// Sends the whole buffer. What the socket takes right away costs no
+// suspension; the rest waits for send space without holding up the other
+// connections. await_resume() reports whether the peer was still there.
+struct writeAwaiter {
+    int fd;
+    const std::string& buf;
+    size_t sent;
+    bool ok;
+    std::coroutine_handle<> waiting;
+
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> h);
+    bool await_resume() const { return ok; }
+};
+
+inline writeAwaiter writeAll(int fd, const std::string& buf) { return writeAwaiter{fd, buf, 0, false, nullptr}; }
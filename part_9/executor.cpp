@@ -0,0 +1,248 @@
+#include "reactor.hpp"
+#include <new>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+// ----- work-stealing executor -----
+// Every worker owns a Chase-Lev deque: the owner pushes and pops at the
+// bottom, idle workers steal from the top. Tasks submitted from outside
+// the pool (proactor handlers, main) go through a shared injection queue.
+
+struct TaskGroup {
+    std::atomic<int> remaining;
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+struct Task {
+    taskFunc   func;
+    void*      arg;
+    TaskGroup* group;             // NULL for fire-and-forget tasks
+};
+
+class WorkDeque {
+public:
+    static const int64_t CAPACITY = 4096;   // power of two
+
+    WorkDeque() : top_(0), bottom_(0) {
+        for (int64_t i = 0; i < CAPACITY; ++i) buf_[i].store(NULL, std::memory_order_relaxed);
+    }
+
+    // owner only; false when full
+    bool push(Task* t) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t tp = top_.load(std::memory_order_acquire);
+        if (b - tp >= CAPACITY) return false;
+        buf_[b & (CAPACITY - 1)].store(t, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // owner only
+    Task* pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {                             // empty
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return NULL;
+        }
+        Task* x = buf_[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b) {                            // last one: race the thieves
+            if (!top_.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                x = NULL;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return x;
+    }
+
+    // any thread
+    Task* steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return NULL;
+        Task* x = buf_[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return NULL;                         // lost the race, try elsewhere
+        }
+        return x;
+    }
+
+private:
+    std::atomic<int64_t> top_;
+    std::atomic<int64_t> bottom_;
+    std::atomic<Task*> buf_[CAPACITY];
+};
+
+struct executor {
+    std::vector<WorkDeque*> deques;
+    std::vector<std::thread> threads;
+
+    std::mutex injectMtx;
+    std::deque<Task*> injected;
+
+    std::atomic<int> pending;     // submitted but not yet taken
+    std::atomic<int> sleepers;
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+    std::atomic<bool> stopping;
+
+    executor() : pending(0), sleepers(0), stopping(false) {}
+};
+
+static thread_local executor* tlsExecutor = NULL;
+static thread_local int tlsWorker = -1;
+
+static void wakeOne(executor* E) {
+    if (E->sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(E->sleepMtx);
+        E->sleepCv.notify_one();
+    }
+}
+
+static void enqueue(executor* E, Task* t) {
+    E->pending.fetch_add(1);
+    if (tlsExecutor != E || !E->deques[tlsWorker]->push(t)) {
+        std::lock_guard<std::mutex> lock(E->injectMtx);
+        E->injected.push_back(t);
+    }
+    wakeOne(E);
+}
+
+static Task* takeInjected(executor* E) {
+    std::lock_guard<std::mutex> lock(E->injectMtx);
+    if (E->injected.empty()) return NULL;
+    Task* t = E->injected.front();
+    E->injected.pop_front();
+    return t;
+}
+
+// own deque first, then the shared queue, then steal round-robin
+static Task* findTask(executor* E, int self) {
+    Task* t = NULL;
+    if (self >= 0) t = E->deques[self]->pop();
+    if (!t) t = takeInjected(E);
+    int n = (int)E->deques.size();
+    for (int i = 1; !t && i <= n; ++i) {
+        int victim = (self + i) % n;
+        if (victim != self) t = E->deques[victim]->steal();
+    }
+    if (t) E->pending.fetch_sub(1);
+    return t;
+}
+
+static void runTask(Task* t) {
+    t->func(t->arg);
+    TaskGroup* g = t->group;
+    delete t;
+    if (g) {
+        // decrement under the lock so the waiter cannot return (and take
+        // the group off its stack) while we still touch it
+        std::lock_guard<std::mutex> lock(g->mtx);
+        if (g->remaining.fetch_sub(1) == 1) g->cv.notify_all();
+    }
+}
+
+static void workerLoop(executor* E, int self) {
+    tlsExecutor = E;
+    tlsWorker = self;
+
+    for (;;) {
+        Task* t = findTask(E, self);
+        if (t) { runTask(t); continue; }
+
+        // nothing anywhere: sleep until a submit or stop. sleepers is
+        // raised before pending is re-checked, so a concurrent submit
+        // either sees the sleeper or we see its task.
+        std::unique_lock<std::mutex> lock(E->sleepMtx);
+        E->sleepers.fetch_add(1);
+        while (E->pending.load() == 0 && !E->stopping.load()) {
+            E->sleepCv.wait(lock);
+        }
+        E->sleepers.fetch_sub(1);
+        if (E->stopping.load() && E->pending.load() == 0) break;
+    }
+}
+
+void* startExecutor(int nworkers) {
+    if (nworkers <= 0) {
+        nworkers = (int)std::thread::hardware_concurrency();
+        if (nworkers <= 0) nworkers = 4;
+    }
+    executor* E = new (std::nothrow) executor();
+    if (!E) return NULL;
+    for (int i = 0; i < nworkers; ++i) E->deques.push_back(new WorkDeque());
+    for (int i = 0; i < nworkers; ++i) E->threads.push_back(std::thread(workerLoop, E, i));
+    return E;
+}
+
+int submitTask(void* ep, taskFunc func, void* arg) {
+    if (!ep || !func) return -1;
+    executor* E = static_cast<executor*>(ep);
+    if (E->stopping.load()) return -1;
+    Task* t = new (std::nothrow) Task{func, arg, NULL};
+    if (!t) return -1;
+    enqueue(E, t);
+    return 0;
+}
+
+int runTasks(void* ep, taskFunc func, void** args, int n) {
+    if (!ep || !func || n < 0) return -1;
+    executor* E = static_cast<executor*>(ep);
+    if (n == 0) return 0;
+
+    TaskGroup g;
+    g.remaining.store(n);
+    for (int i = 0; i < n; ++i) {
+        Task* t = new (std::nothrow) Task{func, args ? args[i] : NULL, &g};
+        if (!t) {
+            // run what could not be queued right here
+            func(args ? args[i] : NULL);
+            std::lock_guard<std::mutex> lock(g.mtx);
+            g.remaining.fetch_sub(1);
+            continue;
+        }
+        enqueue(E, t);
+    }
+
+    if (tlsExecutor == E) {
+        // a worker must not block: keep executing tasks until ours are done
+        while (g.remaining.load() > 0) {
+            Task* t = findTask(E, tlsWorker);
+            if (t) runTask(t);
+            else std::this_thread::yield();
+        }
+        std::lock_guard<std::mutex> lock(g.mtx);   // last finisher has let go
+    } else {
+        std::unique_lock<std::mutex> lock(g.mtx);
+        while (g.remaining.load() > 0) g.cv.wait(lock);
+    }
+    return 0;
+}
+
+int stopExecutor(void* ep) {
+    if (!ep) return -1;
+    executor* E = static_cast<executor*>(ep);
+    {
+        std::lock_guard<std::mutex> lock(E->sleepMtx);
+        E->stopping = true;
+        E->sleepCv.notify_all();
+    }
+    // workers finish everything already submitted before leaving
+    for (size_t i = 0; i < E->threads.size(); ++i) E->threads[i].join();
+    for (size_t i = 0; i < E->deques.size(); ++i) delete E->deques[i];
+    delete E;
+    return 0;
+}
@@ -1,68 +1,123 @@
 #include "reactor.hpp"
-#include <algorithm>
 #include <new>
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <deque>
+#include <set>
+#include <stdint.h>
 #include <unistd.h>
-#include <sys/select.h>
-#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
 #include <errno.h>
-#include <iostream>
 #include <sys/socket.h>
+#include <limits.h>
+#include <memory>
+#include <fcntl.h>
+#include <poll.h>
 
 
 
 struct ProactorData {
     int sockfd;
     proactorFunc func;
+    std::shared_ptr<void> adm;        // outlives the accept thread if clients do
 };
 
+// Accepts from the (nonblocking) listener until the backlog is empty, so a
+// storm costs one wakeup per batch instead of per client. Connections over
+// the admission budget are told so and closed; the rest go to
+// admitted(fd). Returns false once the listener is unusable.
+template <class F>
+static bool acceptAll(int listenSockfd, void* adm, F admitted) {
+    for (;;) {
+        sockaddr_storage peer;
+        socklen_t len = sizeof(peer);
+        int clientSockfd = accept4(listenSockfd, (sockaddr*)&peer, &len, SOCK_CLOEXEC);
+        if (clientSockfd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            logPrintf(LOG_LEVEL_ERROR, "accept: %m");
+            return false;                     // fatal error / listener closed
+        }
+        if (!admitConnection(adm, (sockaddr*)&peer)) {
+            (void)!send(clientSockfd, "Server busy\n", 12, MSG_DONTWAIT);
+            close(clientSockfd);
+            continue;
+        }
+        admitted(clientSockfd);
+    }
+}
+
+// acceptAll() once the listener is readable, for the thread-per-client
+// accept loop
+template <class F>
+static bool acceptBatch(int listenSockfd, void* adm, F admitted) {
+    pollfd p{listenSockfd, POLLIN, 0};
+    if (poll(&p, 1, -1) < 0) return errno == EINTR;   // poll() is a cancellation point
+    if (p.revents & (POLLERR | POLLNVAL)) return false;
+    return acceptAll(listenSockfd, adm, admitted);
+}
+
+static void setNonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
 static void* clientEntry(void* arg) {
     ProactorData* data = static_cast<ProactorData*>(arg);
     int sockfd = data->sockfd;
     proactorFunc func = data->func;
+    std::shared_ptr<void> adm = data->adm;
     delete data;                      
     (void)func(sockfd);                  // run user handler (may close fd)
+    releaseConnection(adm.get());
     return nullptr;
 }
 
 static void* acceptEntry(void* arg) {
-    // Make this thread cancellable; accept() is a cancellation point
+    // Make this thread cancellable; poll() is a cancellation point
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
     pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, nullptr);
 
     ProactorData* data = static_cast<ProactorData*>(arg);
     int listenSockfd   = data->sockfd;
     proactorFunc func  = data->func;
+    std::shared_ptr<void> adm = data->adm;
     delete data;     
 
-    for (;;) {
-        int clientSockfd = accept(listenSockfd, nullptr, nullptr);
-        if (clientSockfd < 0) {
-            if (errno == EINTR) continue;    // interrupted by signal; try again
-            perror("accept");
-            break;                            // fatal error / listener closed
-        }
-
-        // Spawn a detached worker thread
-        ProactorData* clientData = new ProactorData{clientSockfd, func};
-        pthread_t clientTid;
-        if (pthread_create(&clientTid, nullptr, clientEntry, clientData) == 0) {
-            pthread_detach(clientTid);
-        } else {
-            close(clientSockfd);
-            delete clientData;
-        }
+    bool ok = true;
+    while (ok) {
+        ok = acceptBatch(listenSockfd, adm.get(), [&](int clientSockfd) {
+            // Spawn a detached worker thread
+            ProactorData* clientData = new ProactorData{clientSockfd, func, adm};
+            pthread_t clientTid;
+            if (pthread_create(&clientTid, nullptr, clientEntry, clientData) == 0) {
+                pthread_detach(clientTid);
+            } else {
+                close(clientSockfd);
+                releaseConnection(adm.get());
+                delete clientData;
+            }
+        });
     }
     return nullptr;
 }
 
 pthread_t startProactor(int sockfd, proactorFunc threadfunc) {
+    return startProactorLimited(sockfd, threadfunc, nullptr);
+}
+
+pthread_t startProactorLimited(int sockfd, proactorFunc threadfunc, const admissionConfig* adm) {
     pthread_t tid{};
-    ProactorData* data = new ProactorData{sockfd, threadfunc};
+    ProactorData* data = new ProactorData{sockfd, threadfunc, std::shared_ptr<void>()};
+    if (adm) data->adm = std::shared_ptr<void>(newAdmission(adm), freeAdmission);
+    setNonblocking(sockfd);
     if (pthread_create(&tid, nullptr, acceptEntry, data) != 0) {
-        std::cerr << "Error creating proactor thread\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error creating proactor thread");
         delete data;                      // matches new
         return pthread_t{};               // 0 = failure
     }
@@ -76,106 +131,515 @@ int stopProactor(pthread_t tid) {
     return 0;
 }
 
+// ----- pooled proactor -----
+struct poolConn {
+    int fd;
+    void* state;                  // the handler's, between turns
+    bool parked;                  // waiting in epfd for input
+    bool listener;                // a listening socket: accept, don't serve
+};
+
+struct proactorPool {
+    poolFunc func;
+    proactorConfig cfg;
+
+    int epfd;                     // listeners, wakefd and parked connections
+    int wakefd;                   // stopProactorPool -> poller
+    pthread_t pollerTid;
+    std::vector<pthread_t> workers;
+    void* adm;                    // per-source rate limit only, conns is the cap
+
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    std::deque<poolConn*> ready;  // has input (or is closing), waiting for a worker
+    std::set<poolConn*> conns;    // open: parked, ready or in a turn
+    std::vector<poolConn*> listeners;
+    bool stopping;
+};
+
+static bool poolAccept(proactorPool* P, int listenSockfd) {
+    return acceptAll(listenSockfd, P->adm, [P](int clientSockfd) {
+        poolConn* c = nullptr;
+        pthread_mutex_lock(&P->mtx);
+        if ((int)P->conns.size() < P->cfg.max_conns) {
+            c = new (std::nothrow) poolConn{clientSockfd, nullptr, true, false};
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.ptr = c;
+            if (c && epoll_ctl(P->epfd, EPOLL_CTL_ADD, clientSockfd, &ev) == 0) {
+                P->conns.insert(c);
+            } else {
+                delete c;
+                c = nullptr;
+            }
+        }
+        pthread_mutex_unlock(&P->mtx);
+
+        if (!c) {                             // over budget: shed
+            (void)!send(clientSockfd, "Server busy\n", 12, MSG_DONTWAIT);
+            close(clientSockfd);
+        }
+        releaseConnection(P->adm);            // rate limit only, nothing stays open
+    });
+}
+
+// Accepts, and hands connections with input to the workers. Each parked
+// connection is armed once (EPOLLONESHOT), so it is never queued twice and
+// nothing watches it while a worker has it.
+static void* poolPollerEntry(void* arg) {
+    proactorPool* P = static_cast<proactorPool*>(arg);
+    epoll_event evs[64];
+    for (;;) {
+        int n = epoll_wait(P->epfd, evs, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            logPrintf(LOG_LEVEL_ERROR, "epoll_wait: %m");
+            return nullptr;
+        }
+        for (int i = 0; i < n; ++i) {
+            void* p = evs[i].data.ptr;
+            if (p == &P->wakefd) return nullptr;
+            poolConn* c = static_cast<poolConn*>(p);
+            if (c->listener) {
+                // a broken listener would stay readable: stop accepting on it, keep serving
+                if (!poolAccept(P, c->fd)) epoll_ctl(P->epfd, EPOLL_CTL_DEL, c->fd, nullptr);
+                continue;
+            }
+            pthread_mutex_lock(&P->mtx);
+            c->parked = false;
+            P->ready.push_back(c);
+            pthread_cond_signal(&P->cv);
+            pthread_mutex_unlock(&P->mtx);
+        }
+    }
+}
 
+static void* poolWorkerEntry(void* arg) {
+    proactorPool* P = static_cast<proactorPool*>(arg);
+    pthread_mutex_lock(&P->mtx);
+    for (;;) {
+        while (P->ready.empty() && !P->stopping)
+            pthread_cond_wait(&P->cv, &P->mtx);
+        if (P->ready.empty()) break;          // stopping and nothing queued
+
+        poolConn* c = P->ready.front();
+        P->ready.pop_front();
+        pthread_mutex_unlock(&P->mtx);
+
+        bool keep = P->func(c->fd, &c->state) != 0;
+
+        pthread_mutex_lock(&P->mtx);
+        if (keep) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.ptr = c;
+            if (!P->stopping && epoll_ctl(P->epfd, EPOLL_CTL_MOD, c->fd, &ev) == 0) {
+                c->parked = true;
+            } else {
+                // nobody will watch it: one more turn, which sees EOF and ends it
+                shutdown(c->fd, SHUT_RD);
+                P->ready.push_back(c);
+            }
+            continue;
+        }
+        // Closed here, under the lock and together with forgetting c, so a
+        // new connection that gets the same fd number is never mistaken
+        // for this one.
+        P->conns.erase(c);
+        close(c->fd);                         // also drops it from epfd
+        delete c;
+    }
+    pthread_mutex_unlock(&P->mtx);
+    return nullptr;
+}
+
+static bool watchFd(int epfd, int fd, void* tag) {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = tag;
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
 
-enum CmdType { CMD_ADD, CMD_RM, CMD_STOP };
+static void freePool(proactorPool* P) {
+    for (size_t i = 0; i < P->listeners.size(); ++i) delete P->listeners[i];   // the fds are the caller's
+    if (P->epfd >= 0) close(P->epfd);
+    if (P->wakefd >= 0) close(P->wakefd);
+    pthread_mutex_destroy(&P->mtx);
+    pthread_cond_destroy(&P->cv);
+    freeAdmission(P->adm);
+    delete P;
+}
+
+int addPoolListener(void* pool, int sockfd) {
+    proactorPool* P = static_cast<proactorPool*>(pool);
+    if (!P || sockfd < 0) return -1;
+    poolConn* l = new (std::nothrow) poolConn{sockfd, nullptr, false, true};
+    if (!l) return -1;
+    setNonblocking(sockfd);
+    pthread_mutex_lock(&P->mtx);
+    P->listeners.push_back(l);
+    pthread_mutex_unlock(&P->mtx);
+    return watchFd(P->epfd, sockfd, l) ? 0 : -1;
+}
+
+void* startProactorPool(int sockfd, poolFunc func, const proactorConfig* cfg) {
+    if (sockfd < 0 || !func) return NULL;
+
+    proactorPool* P = new (std::nothrow) proactorPool();
+    if (!P) return NULL;
+    P->func = func;
+    P->cfg.workers    = (cfg && cfg->workers > 0) ? cfg->workers : 16;
+    P->cfg.stack_size = cfg ? cfg->stack_size : 0;
+    P->cfg.max_conns  = (cfg && cfg->max_conns > 0) ? cfg->max_conns : 1024;
+    P->cfg.rate_per_sec = cfg ? cfg->rate_per_sec : 0;
+    P->cfg.burst      = cfg ? cfg->burst : 0;
+    P->stopping = false;
+    admissionConfig adm = {0, P->cfg.rate_per_sec, P->cfg.burst};
+    P->adm = newAdmission(&adm);
+    pthread_mutex_init(&P->mtx, nullptr);
+    pthread_cond_init(&P->cv, nullptr);
+    P->epfd = epoll_create1(EPOLL_CLOEXEC);
+    P->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (P->epfd < 0 || P->wakefd < 0 || !watchFd(P->epfd, P->wakefd, &P->wakefd) ||
+        addPoolListener(P, sockfd) < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error setting up proactor pool: %m");
+        freePool(P);
+        return NULL;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (P->cfg.stack_size) {
+        size_t sz = P->cfg.stack_size;
+        if (sz < (size_t)PTHREAD_STACK_MIN) sz = PTHREAD_STACK_MIN;
+        pthread_attr_setstacksize(&attr, sz);
+    }
+
+    for (int i = 0; i < P->cfg.workers; ++i) {
+        pthread_t tid;
+        if (pthread_create(&tid, &attr, poolWorkerEntry, P) != 0) break;
+        P->workers.push_back(tid);
+    }
+    bool ok = !P->workers.empty() &&
+              pthread_create(&P->pollerTid, &attr, poolPollerEntry, P) == 0;
+    pthread_attr_destroy(&attr);
+
+    if (!ok) {
+        logPrintf(LOG_LEVEL_ERROR, "Error creating proactor pool threads");
+        pthread_mutex_lock(&P->mtx);
+        P->stopping = true;
+        pthread_cond_broadcast(&P->cv);
+        pthread_mutex_unlock(&P->mtx);
+        for (size_t i = 0; i < P->workers.size(); ++i) pthread_join(P->workers[i], nullptr);
+        freePool(P);
+        return NULL;
+    }
+    return P;
+}
+
+int stopProactorPool(void* pool) {
+    if (!pool) return -1;
+    proactorPool* P = static_cast<proactorPool*>(pool);
+
+    // no new connections, and no more dispatch, from here on
+    uint64_t one = 1;
+    (void)!write(P->wakefd, &one, sizeof(one));
+    pthread_join(P->pollerTid, nullptr);
+
+    pthread_mutex_lock(&P->mtx);
+    P->stopping = true;
+    // every handler sees EOF on its next read: one in a turn finishes the
+    // command it is on (replies can still be sent), a parked one gets a
+    // last turn to notice, and each then returns 0 and is closed
+    for (std::set<poolConn*>::iterator it = P->conns.begin(); it != P->conns.end(); ++it) {
+        poolConn* c = *it;
+        shutdown(c->fd, SHUT_RD);
+        if (c->parked) {
+            c->parked = false;
+            P->ready.push_back(c);
+        }
+    }
+    pthread_cond_broadcast(&P->cv);
+    pthread_mutex_unlock(&P->mtx);
+
+    for (size_t i = 0; i < P->workers.size(); ++i) pthread_join(P->workers[i], nullptr);
+    freePool(P);
+    return 0;
+}
+
+
+
+enum CmdType { CMD_ADD, CMD_RM, CMD_EVENTS };
 
 struct Cmd {
-    CmdType     t;
-    int         fd;
-    reactorFunc cb;
+    CmdType        t;
+    int            fd;
+    reactorFunc    cb;
+    reactorCtxFunc ctxcb;
+    void*          ctx;
+    int            events;   // CMD_EVENTS
+};
+
+struct CmdNode {
+    Cmd      c;
+    CmdNode* next;
 };
 
+// epoll data for the wake eventfd; registered fds carry (gen << 32) | fd
+static const uint64_t WAKE_TAG = ~(uint64_t)0;
+static const int MAX_EVENTS = 256;
+
 // ----- reactor internals -----
 struct reactor {
-    struct Watch { int fd; reactorFunc cb; };
-
-    std::vector<Watch> watches;   // mutated ONLY in reactor thread
-    int wake_pipe[2];             // [0]=read, [1]=write (both nonblocking)
+    // one slot per fd number, holding either a plain or a ctx callback;
+    // neither set means the slot is free. gen is bumped whenever a
+    // registration ends, so readiness reported for an old registration
+    // is never delivered to a reused fd.
+    struct Slot {
+        reactorFunc    cb;
+        reactorCtxFunc ctxcb;
+        void*          ctx;
+        uint32_t       gen;
+
+        bool used() const { return cb || ctxcb; }
+    };
+
+    std::vector<Slot> slots;      // indexed by fd, mutated ONLY in reactor thread
+    int epfd;
+    int wakefd;                   // eventfd, written once per batch of commands
+    std::atomic<CmdNode*> cmds;   // pushed by any thread, newest first
     std::thread loopThread;
     std::atomic<bool> running;
 
-    reactor() : watches(), wake_pipe{-1,-1}, running(false) {}
+    reactorOptions opts;
+    int spinUs;                   // current busy-poll window, adapts in [0, opts.busy_poll_us]
+
+    reactor() : slots(), epfd(-1), wakefd(-1), cmds(NULL), running(false), opts(), spinUs(0) {
+        opts.cpu = -1;
+    }
 };
 
-// best-effort, nonblocking
-static void sendCmd(reactor* R, const Cmd& c) {
-    if (!R) return;
-    (void)!write(R->wake_pipe[1], &c, sizeof(c));
+static uint64_t slotTag(int fd, uint32_t gen) {
+    return ((uint64_t)gen << 32) | (uint32_t)fd;
 }
 
-// read all queued commands and apply them (runs in reactor thread)
-static void drainAndApply(reactor* R) {
-    for (;;) {
-        Cmd c;
-        ssize_t n = read(R->wake_pipe[0], &c, sizeof(c));
-        if (n != (ssize_t)sizeof(c)) break; // pipe empty (or short read)
-        if (c.t == CMD_ADD) {
-            // update if exists, else push
-            std::vector<reactor::Watch>::iterator it =
-                std::find_if(R->watches.begin(), R->watches.end(),
-                    [&](const reactor::Watch& w){ return w.fd == c.fd; });
-            if (it != R->watches.end()) it->cb = c.cb;
-            else R->watches.push_back(reactor::Watch{c.fd, c.cb});
-        } else if (c.t == CMD_RM) {
-            R->watches.erase(
-                std::remove_if(R->watches.begin(), R->watches.end(),
-                    [&](const reactor::Watch& w){ return w.fd == c.fd; }),
-                R->watches.end());
-        } else if (c.t == CMD_STOP) {
-            R->running = false;
+static void wake(reactor* R) {
+    uint64_t one = 1;
+    (void)!write(R->wakefd, &one, sizeof(one));
+}
+
+// lock-free push; only the producer that finds the queue empty pays for
+// the eventfd write, everyone after it rides on the same wakeup
+static int sendCmd(reactor* R, const Cmd& c) {
+    if (!R) return -1;
+    CmdNode* n = new (std::nothrow) CmdNode{c, NULL};
+    if (!n) return -1;
+
+    CmdNode* head = R->cmds.load(std::memory_order_relaxed);
+    do {
+        n->next = head;
+    } while (!R->cmds.compare_exchange_weak(head, n,
+                std::memory_order_release, std::memory_order_relaxed));
+
+    if (!head) wake(R);
+    return 0;
+}
+
+static void applyAdd(reactor* R, const Cmd& c) {
+    int fd = c.fd;
+    if ((size_t)fd >= R->slots.size()) {
+        R->slots.resize((size_t)fd + 1, reactor::Slot{NULL, NULL, NULL, 0});
+    }
+    reactor::Slot& s = R->slots[fd];
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    bool ok = false;
+    if (s.used()) {
+        // already registered: just swap the callback
+        ev.data.u64 = slotTag(fd, s.gen);
+        ok = epoll_ctl(R->epfd, EPOLL_CTL_MOD, fd, &ev) == 0;
+        if (!ok) {
+            // fd was closed without removeFdFromReactor and the number got
+            // reused; retire the old registration before adding the new one
+            ++s.gen;
         }
     }
+    if (!ok) {
+        ev.data.u64 = slotTag(fd, s.gen);
+        ok = epoll_ctl(R->epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+    s.cb    = ok ? c.cb : NULL;
+    s.ctxcb = ok ? c.ctxcb : NULL;
+    s.ctx   = ok ? c.ctx : NULL;
 }
 
-static void reactorLoop(reactor* R) {
-    while (R->running.load()) {
-        fd_set rfds; FD_ZERO(&rfds);
-        int maxfd = -1;
+static void applyRemove(reactor* R, int fd) {
+    if (fd < 0 || (size_t)fd >= R->slots.size()) return;
+    reactor::Slot& s = R->slots[fd];
+    if (!s.used()) return;
+    // may fail with EBADF if the caller already closed fd; that's fine,
+    // closing removed it from the epoll set anyway
+    (void)epoll_ctl(R->epfd, EPOLL_CTL_DEL, fd, NULL);
+    s.cb = NULL;
+    s.ctxcb = NULL;
+    s.ctx = NULL;
+    ++s.gen;
+}
+
+static void applyEvents(reactor* R, int fd, int events) {
+    if (fd < 0 || (size_t)fd >= R->slots.size()) return;
+    reactor::Slot& s = R->slots[fd];
+    if (!s.used()) return;
+    epoll_event ev{};
+    if (events & REACTOR_READ) ev.events |= EPOLLIN;
+    if (events & REACTOR_WRITE) ev.events |= EPOLLOUT;
+    ev.data.u64 = slotTag(fd, s.gen);
+    (void)epoll_ctl(R->epfd, EPOLL_CTL_MOD, fd, &ev);
+}
 
-        // always watch the wake pipe
-        FD_SET(R->wake_pipe[0], &rfds);
-        if (R->wake_pipe[0] > maxfd) maxfd = R->wake_pipe[0];
+// take every queued command and apply them in order (runs in reactor thread)
+static void drainAndApply(reactor* R) {
+    // reset the eventfd BEFORE taking the queue: a producer that pushes
+    // after the exchange sees an empty queue and writes a fresh wakeup
+    uint64_t cnt;
+    (void)!read(R->wakefd, &cnt, sizeof(cnt));
+
+    CmdNode* n = R->cmds.exchange(NULL, std::memory_order_acquire);
+
+    // the stack is newest-first; reverse it to apply in submission order
+    CmdNode* fifo = NULL;
+    while (n) {
+        CmdNode* next = n->next;
+        n->next = fifo;
+        fifo = n;
+        n = next;
+    }
 
-        // watch all registered fds
-        for (size_t i = 0; i < R->watches.size(); ++i) {
-            FD_SET(R->watches[i].fd, &rfds);
-            if (R->watches[i].fd > maxfd) maxfd = R->watches[i].fd;
+    while (fifo) {
+        CmdNode* next = fifo->next;
+        if (fifo->c.t == CMD_ADD) {
+            applyAdd(R, fifo->c);
+        } else if (fifo->c.t == CMD_RM) {
+            applyRemove(R, fifo->c.fd);
+        } else if (fifo->c.t == CMD_EVENTS) {
+            applyEvents(R, fifo->c.fd, fifo->c.events);
         }
+        delete fifo;
+        fifo = next;
+    }
+}
 
-        int rc = select(maxfd + 1, &rfds, NULL, NULL, NULL);
-        if (rc < 0) {
+static int64_t nowUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Low-latency wait: spin on a non-blocking epoll_wait for up to the current
+// window before sleeping in the kernel. The window doubles when spinning
+// catches an event and halves when it does not; a blocking wait that ends
+// within the maximum window reopens it, since spinning would have caught it.
+static int waitEvents(reactor* R, epoll_event* events) {
+    int maxUs = R->opts.busy_poll_us;
+    if (maxUs <= 0) return epoll_wait(R->epfd, events, MAX_EVENTS, -1);
+
+    if (R->spinUs > 0) {
+        int64_t deadline = nowUs() + R->spinUs;
+        int n;
+        do {
+            n = epoll_wait(R->epfd, events, MAX_EVENTS, 0);
+        } while (n == 0 && nowUs() < deadline);
+        if (n != 0) {
+            R->spinUs = R->spinUs * 2 > maxUs ? maxUs : R->spinUs * 2;
+            return n;
+        }
+        R->spinUs /= 2;
+    }
+
+    int64_t start = nowUs();
+    int n = epoll_wait(R->epfd, events, MAX_EVENTS, -1);
+    int64_t waited = nowUs() - start;
+    if (n > 0 && waited < maxUs) {
+        int want = (int)waited * 2 + 1;
+        if (want > R->spinUs) R->spinUs = want > maxUs ? maxUs : want;
+    }
+    return n;
+}
+
+static thread_local reactor* tCurrentReactor = NULL;   // set on each loop thread
+
+void* currentReactor(void) {
+    return tCurrentReactor;
+}
+
+static void reactorLoop(reactor* R) {
+    epoll_event events[MAX_EVENTS];
+    tCurrentReactor = R;
+
+    if (R->opts.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(R->opts.cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);  // best effort
+    }
+
+    while (R->running.load()) {
+        int n = waitEvents(R, events);
+        if (n < 0) {
             if (errno == EINTR) continue;
             break;
         }
 
         // first apply pending config changes
-        if (FD_ISSET(R->wake_pipe[0], &rfds)) {
-            drainAndApply(R);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.u64 == WAKE_TAG) {
+                drainAndApply(R);
+                break;
+            }
         }
         if (!R->running.load()) break;
 
-        // now dispatch callbacks (changes take effect next loop)
-        for (size_t i = 0; i < R->watches.size(); ++i) {
-            reactorFunc cb = R->watches[i].cb;
-            int fd = R->watches[i].fd;
-            if (cb && FD_ISSET(fd, &rfds)) {
-                (void)cb(fd); // ignore returned void*
+        // now dispatch callbacks; a slot whose generation moved on since
+        // the event was queued belongs to a different registration
+        for (int i = 0; i < n; ++i) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == WAKE_TAG) continue;
+            int fd = (int)(uint32_t)tag;
+            uint32_t gen = (uint32_t)(tag >> 32);
+            const reactor::Slot& s = R->slots[fd];
+            if (s.gen != gen) continue;
+            if (s.ctxcb) {
+                (void)s.ctxcb(fd, s.ctx); // ignore returned void*
+            } else if (s.cb) {
+                (void)s.cb(fd);
             }
         }
     }
 }
 
 void* startReactor() {
+    return startReactorOpts(NULL);
+}
+
+void* startReactorOpts(const reactorOptions* opts) {
     reactor* R = new (std::nothrow) reactor();
     if (!R) return NULL;
-
-    if (pipe(R->wake_pipe) < 0) { delete R; return NULL; }
-
-    // make both ends nonblocking
-    for (int i = 0; i < 2; ++i) {
-        int flags = fcntl(R->wake_pipe[i], F_GETFL, 0);
-        fcntl(R->wake_pipe[i], F_SETFL, flags | O_NONBLOCK);
+    if (opts) R->opts = *opts;
+    R->spinUs = R->opts.busy_poll_us > 0 ? R->opts.busy_poll_us : 0;
+
+    R->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (R->wakefd < 0) { delete R; return NULL; }
+
+    R->epfd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_TAG;
+    if (R->epfd < 0 || epoll_ctl(R->epfd, EPOLL_CTL_ADD, R->wakefd, &ev) < 0) {
+        if (R->epfd != -1) close(R->epfd);
+        close(R->wakefd);
+        delete R;
+        return NULL;
     }
 
     R->running = true;
@@ -184,15 +648,23 @@ void* startReactor() {
 }
 
 int addFdToReactor(void* rp, int fd, reactorFunc func) {
-    if (!rp || fd < 0) return -1;
-    sendCmd(static_cast<reactor*>(rp), Cmd{CMD_ADD, fd, func});
-    return 0;
+    if (!rp || fd < 0 || !func) return -1;
+    return sendCmd(static_cast<reactor*>(rp), Cmd{CMD_ADD, fd, func, NULL, NULL, 0});
+}
+
+int addFdToReactorCtx(void* rp, int fd, reactorCtxFunc func, void* ctx) {
+    if (!rp || fd < 0 || !func) return -1;
+    return sendCmd(static_cast<reactor*>(rp), Cmd{CMD_ADD, fd, NULL, func, ctx, 0});
 }
 
 int removeFdFromReactor(void* rp, int fd) {
     if (!rp) return -1;
-    sendCmd(static_cast<reactor*>(rp), Cmd{CMD_RM, fd, NULL});
-    return 0;
+    return sendCmd(static_cast<reactor*>(rp), Cmd{CMD_RM, fd, NULL, NULL, NULL, 0});
+}
+
+int setFdEvents(void* rp, int fd, int events) {
+    if (!rp || fd < 0) return -1;
+    return sendCmd(static_cast<reactor*>(rp), Cmd{CMD_EVENTS, fd, NULL, NULL, NULL, events});
 }
 
 int stopReactor(void* rp) {
@@ -200,11 +672,42 @@ int stopReactor(void* rp) {
     reactor* R = static_cast<reactor*>(rp);
 
     // tell loop to stop and join it
-    sendCmd(R, Cmd{CMD_STOP, -1, NULL});
+    R->running = false;
+    wake(R);
     if (R->loopThread.joinable()) R->loopThread.join();
 
-    if (R->wake_pipe[0] != -1) close(R->wake_pipe[0]);
-    if (R->wake_pipe[1] != -1) close(R->wake_pipe[1]);
+    // commands that arrived after the last drain are simply dropped
+    CmdNode* n = R->cmds.exchange(NULL, std::memory_order_acquire);
+    while (n) {
+        CmdNode* next = n->next;
+        delete n;
+        n = next;
+    }
+
+    if (R->epfd != -1) close(R->epfd);
+    if (R->wakefd != -1) close(R->wakefd);
     delete R;
     return 0;
+}
+
+int setBusyPoll(int fd, int usec) {
+    if (fd < 0 || usec <= 0) return -1;
+    return setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec));
+}
+
+int openSignalFd(const int* signals, int n) {
+    if (!signals || n <= 0) return -1;
+    sigset_t set;
+    sigemptyset(&set);
+    for (int i = 0; i < n; ++i) sigaddset(&set, signals[i]);
+    if (pthread_sigmask(SIG_BLOCK, &set, NULL) != 0) return -1;
+    return signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+int readSignal(int sigfd) {
+    signalfd_siginfo si;
+    ssize_t n = read(sigfd, &si, sizeof(si));
+    if (n == (ssize_t)sizeof(si)) return (int)si.ssi_signo;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    return -1;
 }
\ No newline at end of file
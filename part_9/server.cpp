@@ -1,190 +1,495 @@
 #include "Graph.hpp"
+#include "GraphCombiner.hpp"
+#include "LineReader.hpp"
+#include "CommandTable.hpp"
+#include "ReplyWriter.hpp"
+#include "ReplyBatch.hpp"
 #include "reactor.hpp"
-#include <iostream>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <string_view>
+#include <cstdlib>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
 #include <unistd.h>
+#include <errno.h>
 #include <mutex>
+#include <future>
 #include <thread>
 #include <signal.h>
+#include <poll.h>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
 
 static constexpr int PORT = 9034;
+static constexpr const char* UNIX_PATH = "/tmp/graph_server.sock";
+static constexpr int WORKERS = 64;
+static constexpr size_t WORKER_STACK = 256 * 1024;
+static constexpr int MAX_CONNS = 1024;     // idle connections hold no worker
+static constexpr double CONN_RATE_PER_SOURCE = 200.0;  // new connections per second
+static constexpr int CONN_BURST_PER_SOURCE = 400;
+static constexpr const char* SNAPSHOT_PATH = "graph.snapshot";
+static constexpr size_t MAX_TXN_OPS = 1 << 16;   // lines one Begin block may hold
+static constexpr size_t PARALLEL_HULL_MIN = 1 << 16;   // below this one thread is faster
+static constexpr int HULL_CHUNKS = 32;
 
 Graph graph;
 std::mutex graphMutex;
+static GraphCombiner gWriter(graph, graphMutex);   // Newpoint/Removepoint/Addedge/Removeedge
+static void* gExecutor = nullptr;
 
-static volatile sig_atomic_t gStopFlag = 0;
-static void on_stop(int) {
-    gStopFlag = 1;
+// the area of graph version gAreaVersion, once someone has worked it out
+static uint64_t gAreaVersion = 0;           // graphMutex
+static std::shared_future<double> gArea;    // graphMutex
+
+
+// "x,y" straight out of a reader line (which is NUL-terminated), no
+// stream; accepts what `in >> x >> comma >> y` did
+static bool parsePoint(std::string_view line, double& x, double& y) {
+    const char* p = line.data();
+    char* end;
+    x = strtod(p, &end);
+    if (end == p || !std::isfinite(x)) return false;
+    p = end;
+    while (*p == ' ' || *p == '	') ++p;
+    if (*p++ != ',') return false;
+    y = strtod(p, &end);
+    return end != p && std::isfinite(y);
 }
 
-bool recvLine(int fd, std::string& line) {
-    line.clear();
-    char c;
-    while (true) {
-        ssize_t n = recv(fd, &c, 1, 0);
-        if (n <= 0) return false; // Error or connection closed
-        if (c == '\n') break;
-        if (c != '\r') line.push_back(c);
+struct HullChunk {
+    std::vector<Point> pts;
+    std::vector<Point> hull;
+};
+
+static void hullChunk(void* arg) {
+    HullChunk* c = static_cast<HullChunk*>(arg);
+    c->hull = Graph::ComputeConvexHull(c->pts);
+}
+
+// The hull of the whole set is the hull of the chunk hulls, so the sorts
+// run as independent executor tasks and only the small merge is serial.
+static double parallelArea(const std::vector<Point>& pts) {
+    std::vector<HullChunk> chunks(HULL_CHUNKS);
+    size_t per = (pts.size() + HULL_CHUNKS - 1) / HULL_CHUNKS;
+    std::vector<void*> args;
+    for (int i = 0; i < HULL_CHUNKS; ++i) {
+        size_t from = i * per;
+        if (from >= pts.size()) break;
+        size_t to = std::min(pts.size(), from + per);
+        chunks[i].pts.assign(pts.begin() + from, pts.begin() + to);
+        args.push_back(&chunks[i]);
+    }
+    runTasks(gExecutor, hullChunk, args.data(), (int)args.size());
+
+    std::vector<Point> merged;
+    for (size_t i = 0; i < args.size(); ++i) {
+        merged.insert(merged.end(), chunks[i].hull.begin(), chunks[i].hull.end());
     }
-    return true; // Successfully received a line
+    return Graph::ComputeArea(Graph::ComputeConvexHull(merged));
 }
 
-void sendAll(int fd, const std::string& message) {
-    const char* msg = message.data();
-    size_t msgLength = message.size();
-    while(msgLength > 0) {
-        ssize_t n = send(fd, msg, msgLength, 0);
-        if (n < 0) {
-            std::cerr << "Error sending data\n";
-            return; // Handle error appropriately
+// what a command handler works with, on whichever worker runs the turn
+struct Session {
+    int fd;
+    LineReader& reader;
+    ReplyBatch& replies;
+};
+
+// one per command; false ends the connection. args is what follows the name.
+typedef bool (*CommandHandler)(Session& s, std::string_view args);
+
+static bool onNewgraph(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    int n; in >> n;
+    std::vector<Point> pts;
+    std::string_view line;
+    bool readOk = true;
+
+    for (int i = 0; i < n; ++i) {
+        if (!s.reader.hasLine()) s.replies.flush();
+        if (!s.reader.readLine(line)){
+            readOk = false;
+            break;
+        } 
+        if (line.empty()) { i--; continue; }
+        double x, y;
+        if (!parsePoint(line, x, y)) {
+            readOk = false;
+            ReplyWriter(s.replies.buffer()) << "Invalid point format: " << line << "\n";
+            break;
         }
-        msg += n;
-        msgLength -= n;
+        pts.emplace_back(Point{x,y});
+    }
+    if(readOk){
+        std::lock_guard<std::mutex> lock(graphMutex);
+        graph.newGraph(pts);
+        s.replies.add("New graph created\n");
     }
+    return true;
 }
 
+// Single flight per graph version: the first CH to find the version
+// without an area computes it; every CH for that version meanwhile, or
+// until the graph next changes, waits on the same future instead of
+// redoing the hull. If the leader fails, everyone waiting gets its
+// exception and the version is left without an area, for the next CH to
+// try again.
+static double currentArea() {
+    std::promise<double> mine;
+    std::shared_future<double> area;
+    std::vector<Point> pts;
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        version = graph.version();
+        if (gArea.valid() && gAreaVersion == version) {
+            area = gArea;
+        } else {
+            area = mine.get_future().share();
+            gArea = area;
+            gAreaVersion = version;
+            try {
+                if (graph.getPoints().size() < PARALLEL_HULL_MIN) mine.set_value(graph.area());
+                else pts = graph.getPoints();
+            } catch (...) {
+                mine.set_exception(std::current_exception());
+                gArea = std::shared_future<double>();
+            }
+        }
+    }
+    if (!pts.empty()) {
+        try {
+            mine.set_value(parallelArea(pts));
+        } catch (...) {
+            mine.set_exception(std::current_exception());
+            std::lock_guard<std::mutex> lock(graphMutex);
+            if (gAreaVersion == version) gArea = std::shared_future<double>();   // still ours
+        }
+    }
+    return area.get();
+}
 
-static void* handleClient(int clientSocket) {
-    std::string line;
+static bool onCH(Session& s, std::string_view) {
+    double area;
+    try {
+        area = currentArea();
+    } catch (const std::exception& e) {
+        logPrintf(LOG_LEVEL_ERROR, "CH failed: %s", e.what());
+        s.replies.add("Cannot compute area\n");
+        return true;
+    }
+    ReplyWriter(s.replies.buffer()) << "Area = " << area << "\n";
+    return true;
+}
 
-    while (recvLine(clientSocket, line)) {
-        if (line.empty()) continue;
-        std::istringstream in(line);
-        std::string cmd;
-        in >> cmd;
-
-        if (cmd == "Newgraph") {
-            int n; in >> n;
-            std::vector<Point> pts;
-            bool readOk = true;
-
-            for (int i = 0; i < n; ++i) {
-                if (!recvLine(clientSocket, line)){
-                    readOk = false;
-                    break;
-                } 
-                if (line.empty()) { i--; continue; }
-                double x, y; char comma;
-                std::istringstream ptin(line);
-                if (!(ptin >> x >> comma >> y) || comma != ',') {
-                    std::ostringstream err;
-                    err << "Invalid point format: " << line << "\n";
-                    readOk = false;
-                    sendAll(clientSocket, err.str());
-                    break;
-                }
-                pts.emplace_back(Point{x,y});
-            }
-            if(readOk){
-                std::lock_guard<std::mutex> lock(graphMutex);
-                graph.newGraph(pts);
-                sendAll(clientSocket, "New graph created\n");
-            }
-            continue;
+static bool onNewpoint(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        s.replies.add("Invalid point format\n");
+        return true;
+    }
 
-        } else if (cmd == "CH") {
-            double area;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                area = graph.area();
-            }
-            std::ostringstream out;
-            out << "Area = " << area << std::endl;
-            sendAll(clientSocket, out.str());
-
-        } else if (cmd == "Newpoint") {
-            double x, y; char comma;
-            in >> x >> comma >> y;
-            if (comma != ',') {
-                sendAll(clientSocket, "Invalid point format\n");
-                continue;
-            }
+    if (!gWriter.addPoint(Point{x, y})) {
+        s.replies.add("Failed to add point (duplicate)\n");
+        return true;
+    }
+    ReplyWriter(s.replies.buffer()) << "Point added: " << x << "," << y << "\n";
+    return true;
+}
 
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.addPoint(Point{x, y})) {
-                    sendAll(clientSocket, "Failed to add point (duplicate)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Point added: " << x << "," << y << "\n";
-            sendAll(clientSocket, response.str());
-
-        } else if (cmd == "Removepoint") {
-            double x, y; char comma;
-            in >> x >> comma >> y;
-            if (comma != ',') {
-                sendAll(clientSocket, "Invalid point format\n");
-                continue;
-            }
+static bool onRemovepoint(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x, y; char comma;
+    in >> x >> comma >> y;
+    if (comma != ',') {
+        s.replies.add("Invalid point format\n");
+        return true;
+    }
 
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.removePoint(Point{x, y})) {
-                    sendAll(clientSocket, "Failed to remove point (not found)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Point removed: " << x << "," << y << "\n";
-            sendAll(clientSocket, response.str());
-            
-
-        } else if (cmd == "Addedge") {
-            double x1, y1, x2, y2; char comma1, comma2;
-            in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.addEdge(Point{x1, y1}, Point{x2, y2})) {
-                    sendAll(clientSocket, "Failed to add edge (duplicate)\n");
-                    continue;
-                }
-            }
-            std::ostringstream response;
-            response << "Edge added: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
-            sendAll(clientSocket, response.str());
-
-        } else if (cmd == "Removeedge") {
-            double x1, y1, x2, y2; char comma1, comma2;
-            in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                if (!graph.removeEdge(Point{x1, y1}, Point{x2, y2})) {
-                    sendAll(clientSocket, "Failed to remove edge (not found)\n");
-                    continue;
-                }
+    if (!gWriter.removePoint(Point{x, y})) {
+        s.replies.add("Failed to remove point (not found)\n");
+        return true;
+    }
+    ReplyWriter(s.replies.buffer()) << "Point removed: " << x << "," << y << "\n";
+    return true;
+}
+
+static bool onAddedge(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char comma1, comma2;
+    in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+    if (!gWriter.addEdge(Point{x1, y1}, Point{x2, y2})) {
+        s.replies.add("Failed to add edge (duplicate)\n");
+        return true;
+    }
+    ReplyWriter(s.replies.buffer()) << "Edge added: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
+    return true;
+}
+
+static bool onRemoveedge(Session& s, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    double x1, y1, x2, y2; char comma1, comma2;
+    in >> x1 >> comma1 >> y1 >> x2 >> comma2 >> y2;
+    if (!gWriter.removeEdge(Point{x1, y1}, Point{x2, y2})) {
+        s.replies.add("Failed to remove edge (not found)\n");
+        return true;
+    }
+    ReplyWriter(s.replies.buffer()) << "Edge removed: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
+    return true;
+}
+
+// one line of a Begin/Commit block, parsed before anything is applied
+struct TxnOp {
+    Command cmd;
+    Point a, b;
+    const char* error;   // set if the line can't go into a transaction
+    bool ok;
+    double area;
+};
+
+static const char* parseTxnOp(TxnOp& op, std::string_view args) {
+    std::istringstream in{std::string(args)};
+    char c1, c2;
+    switch (op.cmd) {
+    case CMD_NEWPOINT:
+    case CMD_REMOVEPOINT:
+        if (!(in >> op.a.x >> c1 >> op.a.y) || c1 != ',') return "Invalid point format\n";
+        return nullptr;
+    case CMD_ADDEDGE:
+    case CMD_REMOVEEDGE:
+        if (!(in >> op.a.x >> c1 >> op.a.y >> op.b.x >> c2 >> op.b.y) || c1 != ',' || c2 != ',')
+            return "Invalid edge format\n";
+        return nullptr;
+    case CMD_CH:
+        return nullptr;
+    case CMD_NEWGRAPH:
+        return "Newgraph is not allowed in a transaction\n";
+    case CMD_BEGIN:
+        return "Transaction already in progress\n";
+    default:
+        return "Unknown command\n";
+    }
+}
+
+// Begin: the lines up to Commit are parsed first, then applied under one
+// graphMutex acquisition, so no other client sees the block half done.
+// Each line gets its usual reply, all sent together and followed by
+// "Committed". If any line doesn't parse, nothing is applied: that line
+// gets its error, the others "Not applied", and the block ends "Aborted".
+// A block longer than MAX_TXN_OPS is aborted as soon as it gets there and
+// the connection closed: the rest of it can be neither kept nor run alone.
+static bool onBegin(Session& s, std::string_view) {
+    std::vector<TxnOp> ops;
+    bool valid = true;
+    std::string_view line;
+    for (;;) {
+        if (!s.reader.hasLine()) s.replies.flush();
+        if (!s.reader.readLine(line)) return false;   // gone mid-block: nothing applied
+        if (line.empty()) continue;
+        std::string_view args;
+        Command cmd = lookupCommand(splitCommand(line, args));
+        if (cmd == CMD_COMMIT) break;
+        if (ops.size() == MAX_TXN_OPS) {
+            s.replies.add("Transaction too large\nAborted\n");
+            return false;
+        }
+        TxnOp op{cmd, Point{0, 0}, Point{0, 0}, nullptr, false, 0};
+        op.error = parseTxnOp(op, args);
+        if (op.error) valid = false;
+        ops.push_back(op);
+    }
+
+    ReplyWriter out(s.replies.buffer());
+    if (!valid) {
+        for (const TxnOp& op : ops) out << (op.error ? op.error : "Not applied\n");
+        out << "Aborted\n";
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        for (TxnOp& op : ops) {
+            switch (op.cmd) {
+            case CMD_NEWPOINT:    op.ok = graph.addPoint(op.a); break;
+            case CMD_REMOVEPOINT: op.ok = graph.removePoint(op.a); break;
+            case CMD_ADDEDGE:     op.ok = graph.addEdge(op.a, op.b); break;
+            case CMD_REMOVEEDGE:  op.ok = graph.removeEdge(op.a, op.b); break;
+            case CMD_CH:          op.area = graph.area(); break;
+            default: break;
             }
-            std::ostringstream response;
-            response << "Edge removed: (" << x1 << "," << y1 << ") - (" << x2 << "," << y2 << ")\n";
-            sendAll(clientSocket, response.str());
+        }
+    }
 
-        } else {
-            sendAll(clientSocket, "Unknown command\n");
+    for (const TxnOp& op : ops) {
+        switch (op.cmd) {
+        case CMD_NEWPOINT:
+            if (op.ok) out << "Point added: " << op.a.x << "," << op.a.y << "\n";
+            else out << "Failed to add point (duplicate)\n";
+            break;
+        case CMD_REMOVEPOINT:
+            if (op.ok) out << "Point removed: " << op.a.x << "," << op.a.y << "\n";
+            else out << "Failed to remove point (not found)\n";
+            break;
+        case CMD_ADDEDGE:
+            if (op.ok) out << "Edge added: (" << op.a.x << "," << op.a.y << ") - (" << op.b.x << "," << op.b.y << ")\n";
+            else out << "Failed to add edge (duplicate)\n";
+            break;
+        case CMD_REMOVEEDGE:
+            if (op.ok) out << "Edge removed: (" << op.a.x << "," << op.a.y << ") - (" << op.b.x << "," << op.b.y << ")\n";
+            else out << "Failed to remove edge (not found)\n";
+            break;
+        case CMD_CH:
+            out << "Area = " << op.area << "\n";
+            break;
+        default:
             break;
         }
     }
-    close(clientSocket);
-    return nullptr;
+    out << "Committed\n";
+    return true;
+}
+
+static bool onCommit(Session& s, std::string_view) {
+    s.replies.add("No transaction in progress\n");
+    return true;
+}
+
+static bool onUnknown(Session& s, std::string_view) {
+    s.replies.add("Unknown command\n");
+    return false;
+}
+
+static constexpr CommandDispatch<CommandHandler> COMMANDS{onUnknown, {
+    {CMD_NEWGRAPH, onNewgraph},
+    {CMD_CH, onCH},
+    {CMD_NEWPOINT, onNewpoint},
+    {CMD_REMOVEPOINT, onRemovepoint},
+    {CMD_ADDEDGE, onAddedge},
+    {CMD_REMOVEEDGE, onRemoveedge},
+    {CMD_BEGIN, onBegin},
+    {CMD_COMMIT, onCommit},
+}};
+
+// A client's state between its turns on the pool.
+struct Client {
+    explicit Client(int fd) : reader(fd), replies(fd), s{fd, reader, replies} {}
+    LineReader reader;
+    ReplyBatch replies;
+    Session s;
+};
+
+// One turn: the commands the client has sent so far. Between commands the
+// connection goes back to the pool instead of holding a worker while the
+// client is quiet; inside one (a Newgraph's points, a Begin block) it still
+// reads on until the command is whole.
+static int handleClient(int clientSocket, void** conn) {
+    Client* c = static_cast<Client*>(*conn);
+    if (!c) {
+        c = new Client(clientSocket);
+        *conn = c;
+        // replies are coalesced per batch, so Nagle would only add delay
+        int one = 1;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    std::string_view line;
+
+    for (;;) {
+        if (!c->reader.hasLine()) {
+            // about to wait for input: whatever this batch produced goes out now
+            if (!c->replies.flush()) break;
+            ssize_t n = c->reader.fill(MSG_DONTWAIT);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 1;   // quiet: back to the pool
+            if (n <= 0) break;
+            continue;
+        }
+        c->reader.nextLine(line);
+        if (line.empty()) continue;
+        std::string_view args;
+        std::string_view cmd = splitCommand(line, args);
+        if (!COMMANDS.find(cmd)(c->s, args)) break;
+    }
+    c->replies.flush();
+    delete c;
+    *conn = nullptr;
+    return 0;                                   // the pool closes the socket
+}
+
+// SIGHUP: the graph in Newgraph form, so the file can be replayed through a
+// client; written to a temp file first so a crash never leaves half a snapshot
+static bool writeSnapshot(const char* path) {
+    std::vector<Point> pts;
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        pts = graph.getPoints();
+    }
+    std::string tmp = std::string(path) + ".tmp";
+    {
+        std::ofstream out(tmp.c_str());
+        if (!out) return false;
+        out << "Newgraph " << pts.size() << "\n";
+        for (size_t i = 0; i < pts.size(); ++i) out << pts[i].x << "," << pts[i].y << "\n";
+        if (!out.flush()) return false;
+    }
+    return std::rename(tmp.c_str(), path) == 0;
+}
+
+// main thread parks here; HUP snapshots, anything else means stop
+static void waitForStop(int sigfd) {
+    for (;;) {
+        pollfd p{sigfd, POLLIN, 0};
+        poll(&p, 1, -1);
+        int sig;
+        while ((sig = readSignal(sigfd)) > 0) {
+            if (sig != SIGHUP) return;
+            if (writeSnapshot(SNAPSHOT_PATH)) logPrintf(LOG_LEVEL_INFO, "Snapshot written to %s", SNAPSHOT_PATH);
+            else logPrintf(LOG_LEVEL_ERROR, "Error writing snapshot");
+        }
+        if (sig < 0) return;
+    }
+}
+
+// Unix socket for clients on this host: same protocol, no TCP stack.
+// A socket file left over from a previous run is replaced.
+static int listenUnix(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
 }
 
 int main() {
     signal(SIGPIPE, SIG_IGN);
-    struct sigaction sa;
-    sa.sa_handler = on_stop;
-    sigaction(SIGINT, &sa, nullptr);
-    sigaction(SIGTERM, &sa, nullptr);
+    // before any thread exists, so none of them ever takes these signals
+    const int sigs[] = {SIGINT, SIGTERM, SIGHUP};
+    int sigfd = openSignalFd(sigs, 3);
+    if (sigfd < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error creating signalfd");
+        return 1;
+    }
+    // after the signal mask is set, so the flusher thread inherits it; atexit
+    // writes out whatever is still queued on every way out of main
+    if (startLogger(LOG_LEVEL_INFO) == 0) atexit(stopLogger);
 
-    std::cout << "Starting Graph server on port " << PORT << "...\n";
+    logPrintf(LOG_LEVEL_INFO, "Starting Graph server on port %d...", PORT);
 
     int listenfd = socket(AF_INET, SOCK_STREAM, 0);
     if (listenfd < 0) {
-        std::cerr << "Error creating socket\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error creating socket");
         return 1;  
     }
     sockaddr_in serverAddr;
@@ -196,29 +501,57 @@ int main() {
     setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
 
     if (bind(listenfd, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        std::cerr << "Error binding socket\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error binding socket");
         close(listenfd);
         return 1;
     }
 
     if (listen(listenfd, SOMAXCONN) < 0) {
-        std::cerr << "Error listening on socket\n";
+        logPrintf(LOG_LEVEL_ERROR, "Error listening on socket");
+        close(listenfd);
+        return 1;
+    }
+
+    int unixfd = listenUnix(UNIX_PATH);
+    if (unixfd < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error listening on %s", UNIX_PATH);
+        close(listenfd);
+        return 1;
+    }
+
+    gExecutor = startExecutor(0);
+    if (!gExecutor) {
+        logPrintf(LOG_LEVEL_ERROR, "Error starting executor");
         close(listenfd);
+        close(unixfd);
         return 1;
     }
 
-    pthread_t acceptTid = startProactor(listenfd, &handleClient);
-    if (!acceptTid) {
-        std::cerr << "Error starting proactor thread\n";
+    proactorConfig cfg;
+    cfg.workers = WORKERS;
+    cfg.stack_size = WORKER_STACK;
+    cfg.max_conns = MAX_CONNS;
+    cfg.rate_per_sec = CONN_RATE_PER_SOURCE;
+    cfg.burst = CONN_BURST_PER_SOURCE;
+    void* proactor = startProactorPool(listenfd, &handleClient, &cfg);
+    if (!proactor || addPoolListener(proactor, unixfd) < 0) {
+        logPrintf(LOG_LEVEL_ERROR, "Error starting proactor thread");
+        if (proactor) stopProactorPool(proactor);
+        stopExecutor(gExecutor);
         close(listenfd);
+        close(unixfd);
         return 1;
     }
 
-    pause();
-    std::cout << "Shutting down proactor...\n";
-    stopProactor(acceptTid);
-    std::cout << "Proactor stopped\n";
+    waitForStop(sigfd);
+    logPrintf(LOG_LEVEL_INFO, "Shutting down proactor...");
+    stopProactorPool(proactor);
+    stopExecutor(gExecutor);
+    logPrintf(LOG_LEVEL_INFO, "Proactor stopped");
     close(listenfd);
+    close(unixfd);
+    unlink(UNIX_PATH);
+    close(sigfd);
     return 0;
 
 }
\ No newline at end of file